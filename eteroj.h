@@ -19,6 +19,7 @@
 #define _ETEROJ_LV2_H
 
 #include <stdint.h>
+#include <string.h>
 #if !defined(_WIN32)
 #	include <sys/mman.h>
 #else
@@ -35,6 +36,8 @@
 #include "lv2/lv2plug.in/ns/ext/log/log.h"
 #include "lv2/lv2plug.in/ns/ext/log/logger.h"
 #include "lv2/lv2plug.in/ns/ext/patch/patch.h"
+#include "lv2/lv2plug.in/ns/ext/options/options.h"
+#include "lv2/lv2plug.in/ns/ext/buf-size/buf-size.h"
 #include "lv2/lv2plug.in/ns/extensions/ui/ui.h"
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
@@ -46,6 +49,33 @@
 #define ETEROJ_URL_URI								ETEROJ_URI"#url"
 #define ETEROJ_CONNECTED_URI					ETEROJ_URI"#connected"
 #define ETEROJ_ERROR_URI							ETEROJ_URI"#error"
+#define ETEROJ_THREADED_URI						ETEROJ_URI"#threaded"
+#define ETEROJ_PEERS_URI							ETEROJ_URI"#peers"
+#define ETEROJ_SENT_URI								ETEROJ_URI"#sent"
+#define ETEROJ_RECEIVED_URI						ETEROJ_URI"#received"
+#define ETEROJ_SCHEDULE_URI						ETEROJ_URI"#schedule"
+#define ETEROJ_LEAD_URI								ETEROJ_URI"#lead"
+#define ETEROJ_COALESCE_URI						ETEROJ_URI"#coalesce"
+#define ETEROJ_MTU_URI								ETEROJ_URI"#mtu"
+#define ETEROJ_PACKING_URI						ETEROJ_URI"#packing"
+#define ETEROJ_SENT_BYTES_URI					ETEROJ_URI"#sent_bytes"
+#define ETEROJ_RECEIVED_BYTES_URI			ETEROJ_URI"#received_bytes"
+#define ETEROJ_DROP_INPUT_URI					ETEROJ_URI"#drop_input"
+#define ETEROJ_DROP_OUTPUT_URI				ETEROJ_URI"#drop_output"
+#define ETEROJ_DROP_NETWORK_URI				ETEROJ_URI"#drop_network"
+#define ETEROJ_LATE_URI								ETEROJ_URI"#late"
+#define ETEROJ_LATE_HISTOGRAM_URI			ETEROJ_URI"#late_histogram"
+#define ETEROJ_QUEUE_PEAK_URI					ETEROJ_URI"#queue_peak"
+#define ETEROJ_FILL_INPUT_URI					ETEROJ_URI"#fill_input"
+#define ETEROJ_FILL_OUTPUT_URI				ETEROJ_URI"#fill_output"
+#define ETEROJ_CLOCK_URI							ETEROJ_URI"#clock"
+#define ETEROJ_OFFSET_URI							ETEROJ_URI"#offset"
+#define ETEROJ_JITTER_URI							ETEROJ_URI"#jitter"
+#define ETEROJ_SWITCH_TIME_URI				ETEROJ_URI"#switch_time"
+#define ETEROJ_ENDPOINT_URI						ETEROJ_URI"#endpoint"
+#define ETEROJ_BUFFER_SIZE_URI				ETEROJ_URI"#buffer_size"
+#define ETEROJ_QUEUE_SIZE_URI					ETEROJ_URI"#queue_size"
+#define ETEROJ_WAKEUPS_URI						ETEROJ_URI"#wakeups"
 
 #define ETEROJ_DISK_RECORD_URI				ETEROJ_URI"#disk_record"
 #define ETEROJ_DISK_PATH_URI					ETEROJ_URI"#disk_path"
@@ -70,6 +100,45 @@ extern const LV2_Descriptor eteroj_pack;
 extern const LV2_Descriptor eteroj_ninja;
 extern const LV2_Descriptor eteroj_control;
 
+// room for a number of atom sequences of the size announced by the host via
+// bufsz:sequenceSize, never less than fallback, which is used if the host
+// does not tell
+static inline size_t
+eteroj_ring_size(const LV2_Feature *const *features, LV2_URID_Map *map,
+	unsigned sequences, size_t fallback)
+{
+	const LV2_Options_Option *opts = NULL;
+
+	for(unsigned i=0; features[i]; i++)
+	{
+		if(!strcmp(features[i]->URI, LV2_OPTIONS__options))
+		{
+			opts = features[i]->data;
+		}
+	}
+
+	if(!opts)
+	{
+		return fallback;
+	}
+
+	const LV2_URID sequence_size = map->map(map->handle, LV2_BUF_SIZE__sequenceSize);
+	const LV2_URID atom_int = map->map(map->handle, LV2_ATOM__Int);
+
+	for(const LV2_Options_Option *opt = opts; opt->key; opt++)
+	{
+		if( (opt->key == sequence_size) && (opt->type == atom_int)
+			&& (*(const int32_t *)opt->value > 0) )
+		{
+			const size_t size = (size_t)*(const int32_t *)opt->value * sequences;
+
+			return (size > fallback) ? size : fallback;
+		}
+	}
+
+	return fallback;
+}
+
 // there is a bug in LV2 <= 0.10
 #if defined(LV2_ATOM_TUPLE_FOREACH)
 #	undef LV2_ATOM_TUPLE_FOREACH
@@ -18,6 +18,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#if defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#	include <sys/epoll.h>
+#	include <sys/eventfd.h>
+#endif
 
 #include <eteroj.h>
 #include <varchunk.h>
@@ -27,26 +35,158 @@
 #include <osc.lv2/stream.h>
 #include <props.h>
 
-#define BUF_SIZE 0x100000 // 1M
-#define MTU_SIZE 1500
-#define LIST_SIZE 2048
-#define MAX_NPROPS 3
+#define BUF_SIZE 0x10000 // 64K, of control messages to worker
+#define DEFER_SIZE 0x10000 // 64K, of outgoing events during resizes
+#define ARENA_SIZE 0x100000 // 1M, or more if host announces a large sequence size
+#define ARENA_MIN 0x10000 // 64K, fits the largest datagram
+#define ARENA_MAX 0x4000000 // 64M
+#define ARENA_SEQUENCES 16 // sequences worth of packets per arena by default
+#define LIST_SIZE 2048 // bundles per scheduler by default
+#define LIST_MIN 16
+#define LIST_MAX 0x10000
+#define RELOCATE_MAX 4 // scheduled bundles moved out of the receive ring per period
+#define MAX_NPROPS 29
 #define STR_LEN 128
+#define URL_LEN 512 // whitespace separated list of stream URLs
+#define MAX_ENDPOINTS 4 // streams per instance, one bit each in target masks
+#define IO_TIMEOUT_MS 100 // retry interval for (re)connects
+#define IO_RETRY_MS 1 // retry interval for full socket send buffer
+#define IO_FDS (LV2_OSC_STREAM_FDS * MAX_ENDPOINTS)
+#define MTU_DEFAULT 1472 // UDP payload of an ethernet frame
+#define MTU_MIN 64
+#define MTU_MAX LV2_OSC_STREAM_MMSG_SIZE
+#define LATE_BINS 8 // 16, 64, 256, ... samples
+#define CLOCK_BANDWIDTH 0.5 // Hz, of remote clock loop filter
+#define CLOCK_JITTER_WEIGHT (1.0 / 16)
+#define CLOCK_MARGIN 3.0 // jitters added to corrected timetags
+#define SWITCH_TIMEOUT 5.0 // s, until switching to an endpoint not ready yet
 
 typedef struct _plugstate_t plugstate_t;
 typedef struct _list_t list_t;
+typedef struct _arena_t arena_t;
+typedef struct _sched_t sched_t;
+typedef struct _queue_t queue_t;
+typedef struct _remote_t remote_t;
+typedef struct _endpoint_t endpoint_t;
 typedef struct _plughandle_t plughandle_t;
 
+#if (ARENA_SIZE & (ARENA_SIZE - 1))
+#	error "ARENA_SIZE must be a power of two"
+#endif
+
+#if (LIST_MAX > 0x10000)
+#	error "LIST_MAX must fit into heap slots of records"
+#endif
+
+enum {
+	RESIZE_IDLE = 0,
+	RESIZE_REQUEST = 1, // worker waits for rt to hold off arenas
+	RESIZE_HOLD = 2 // rt leaves arenas to worker
+};
+
+// variable-sized record in arena, padded to 8 bytes
 struct _list_t {
-	double frames;
+	uint32_t size;
+	uint8_t flags;
+	uint8_t tag; // source endpoint of received, target endpoints of outgoing
+	uint16_t slot; // heap index while scheduled
+	uint8_t buf [];
+};
+
+enum {
+	LIST_USED = 0,
+	LIST_FREED = 1,
+	LIST_GAP = 2
+};
+
+// single-producer single-consumer ring of packets, written at head, read in
+// order, released in any order, reclaimed at tail
+struct _arena_t {
+	uint8_t *buf;
 	size_t size;
-	uint8_t buf [MTU_SIZE];
+	atomic_size_t head; // free-running, written by producer
+	atomic_size_t tail; // free-running, written by consumer
+	size_t pending; // producer: position of requested record
+	size_t read; // consumer: next record to unroll
+};
+
+struct _sched_t {
+	uint64_t timetag;
+	uint32_t seq; // arrival order, keeps equal timetags FIFO
+	uint32_t off; // record offset in arena
+	arena_t *arena; // ring record was received in, or queue's own arena
+};
+
+// time-ordered queue of bundles kept in place in the ring they were received
+// in, only the ones pinning its tail are moved to an arena of the queue's own
+struct _queue_t {
+	arena_t arena;
+	sched_t *heap;
+	unsigned size; // capacity of heap
+	unsigned nheap;
+	uint32_t seq;
+	size_t used; // bytes taken by scheduled records
+	bool pinned; // request failed on records in use at tail, left to worker
+};
+
+// remote clock model, tracks worst lateness of received bundles per period
+struct _remote_t {
+	bool locked;
+	unsigned samples; // bundles in current period
+	double late; // s, worst lateness in current period
+	double elapsed; // s, since last update
+	double offset; // s
+	double drift; // s/s
+	double jitter; // s
+};
+
+// one stream per URL, with a second one prepared in background upon changes
+struct _endpoint_t {
+	plughandle_t *handle;
+	unsigned idx;
+	char *url;
+	bool rolling;
+	LV2_OSC_Stream *slots [2]; // allocated on first use
+	LV2_OSC_Stream *stream; // current
+	LV2_OSC_Stream *next; // being prepared after an URL change, NULL if none
+	double since; // s, start of URL change
+	size_t read; // position in outgoing arena
+	size_t peek; // position of packet last handed to stream in outgoing arena
 };
 
 struct _plugstate_t {
-	char osc_url [STR_LEN];
+	char osc_url [URL_LEN];
 	char osc_error [STR_LEN];
 	int32_t osc_connected;
+	int32_t osc_threaded;
+	int32_t osc_peers;
+	int64_t osc_sent;
+	int64_t osc_received;
+	int32_t osc_schedule;
+	int32_t osc_lead;
+	int32_t osc_coalesce;
+	int32_t osc_mtu;
+	float osc_packing;
+	int64_t osc_sent_bytes;
+	int64_t osc_received_bytes;
+	int64_t osc_drop_input;
+	int64_t osc_drop_output;
+	int64_t osc_drop_network;
+	int64_t osc_late;
+	struct {
+		LV2_Atom_Vector_Body body;
+		int64_t bins [LATE_BINS];
+	} osc_late_histogram;
+	int32_t osc_queue_peak;
+	float osc_fill_input;
+	float osc_fill_output;
+	int32_t osc_clock;
+	float osc_offset;
+	float osc_jitter;
+	float osc_switch_time;
+	int32_t osc_buffer_size;
+	int32_t osc_queue_size;
+	int32_t osc_wakeups;
 };
 
 struct _plughandle_t {
@@ -56,6 +196,25 @@ struct _plughandle_t {
 	struct {
 		LV2_URID eteroj_connected;
 		LV2_URID eteroj_error;
+		LV2_URID eteroj_peers;
+		LV2_URID eteroj_sent;
+		LV2_URID eteroj_received;
+		LV2_URID eteroj_packing;
+		LV2_URID eteroj_sent_bytes;
+		LV2_URID eteroj_received_bytes;
+		LV2_URID eteroj_drop_input;
+		LV2_URID eteroj_drop_output;
+		LV2_URID eteroj_drop_network;
+		LV2_URID eteroj_late;
+		LV2_URID eteroj_late_histogram;
+		LV2_URID eteroj_queue_peak;
+		LV2_URID eteroj_fill_input;
+		LV2_URID eteroj_fill_output;
+		LV2_URID eteroj_offset;
+		LV2_URID eteroj_jitter;
+		LV2_URID eteroj_switch_time;
+		LV2_URID eteroj_wakeups;
+		LV2_URID eteroj_endpoint [MAX_ENDPOINTS];
 	} uris;
 
 	PROPS_T(props, MAX_NPROPS);
@@ -76,18 +235,99 @@ struct _plughandle_t {
 	LV2_Atom_Sequence *osc_out;
 
 	LV2_OSC_Schedule *osc_sched;
-	list_t list [LIST_SIZE];
-	unsigned nlist;
+	queue_t rx; // received bundles, dispatched to output port
+	queue_t tx; // outgoing bundles, held back until due
+	double rate;
 
 	struct {
 		LV2_OSC_Driver driver;
-		LV2_OSC_Stream stream;
-		varchunk_t *from_worker;
-		varchunk_t *to_worker;
+		LV2_OSC_Driver prepare; // leaves arenas alone until switched to
+		endpoint_t endpoints [MAX_ENDPOINTS];
+		atomic_uint configured; // worker, endpoints with an URL
+		uint32_t targets; // rt, endpoints of events without subject
+		arena_t to_worker; // outgoing packets, released once sent to all targets
+		arena_t from_worker; // received packets, scheduled ones released once dispatched
 		varchunk_t *to_thread;
 	} data;
 
-	char *osc_url;
+	struct {
+		bool threaded;
+		bool running; // network thread, runs streams if threaded, else watches them
+		atomic_bool active; // network thread runs streams
+		atomic_uint wakers; // rt, in _io_wake while active
+		atomic_bool done;
+		atomic_int ev;
+		atomic_bool connected;
+		int efd;
+		int epfd;
+#if defined(__linux__)
+		pthread_t thread;
+#endif
+	} io;
+
+	// worker is scheduled upon demand plus a keepalive for retries and timeouts
+	struct {
+		atomic_bool pending; // set by worker and network thread for next period
+		bool control; // rt, messages queued for worker
+		uint32_t frames; // rt, since last wakeup
+		uint32_t interval; // rt, keepalive in frames
+		uint32_t count; // rt, wakeups, published once per second
+	} wake;
+
+	// capacities of arenas and schedulers, changed on worker
+	struct {
+		atomic_int state;
+		atomic_bool compact; // rt, resize to current sizes for pinned arenas
+		size_t preset; // arena size derived from host's sequence size
+		size_t arena; // worker, requested arena size
+		unsigned queue; // worker, requested scheduler capacity
+	} resize;
+
+	// updated by whichever thread runs the stream, published once per second
+	struct {
+		atomic_uint peers;
+		atomic_uint_least64_t sent;
+		atomic_uint_least64_t received;
+		atomic_uint_least64_t sent_bytes;
+		atomic_uint_least64_t received_bytes;
+		atomic_uint_least64_t drop_network;
+		atomic_uint switch_time; // us, of last URL change
+		uint32_t period;
+		uint32_t frames;
+	} traffic;
+
+	// updated by rt, published along with traffic
+	struct {
+		uint64_t drop_input;
+		uint64_t drop_output;
+		uint64_t late;
+		uint64_t late_bins [LATE_BINS];
+		unsigned queue_peak;
+	} stats;
+
+	// remote clock models, one per endpoint as senders have clocks of their own
+	struct {
+		uint64_t now; // local time of current period
+		remote_t remotes [MAX_ENDPOINTS];
+	} clock;
+
+	// outgoing events arriving while arenas are resized, sent right after
+	union {
+		LV2_Atom_Sequence seq;
+		uint8_t buf [DEFER_SIZE];
+	} defer;
+
+	// per-period packing of outgoing messages into bundles
+	struct {
+		LV2_OSC_Writer writer;
+		LV2_OSC_Writer_Frame bndl;
+		uint8_t *dst; // bundle open in to_worker, NULL if none
+		uint32_t targets;
+		int64_t frames; // event time of bundle timetag
+		uint32_t items;
+		uint32_t messages; // packing ratio, reset once per second
+		uint32_t packets;
+	} coalesce;
 };
 
 static LV2_State_Status
@@ -115,541 +355,2843 @@ static const LV2_State_Interface state_iface = {
 	.restore = _state_restore
 };
 
-// non-rt
-static void *
-_data_recv_req(void *data, size_t size, size_t *max)
+#define LIST_PAD(SIZE) ( ( (size_t)(SIZE) + 7U ) & ( ~7U ) )
+
+// producer
+static inline list_t *
+_arena_write_request(arena_t *arena, size_t minimum, size_t *maximum)
 {
-	plughandle_t *handle = data;
+	const size_t need = sizeof(list_t) + LIST_PAD(minimum);
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_relaxed);
+	const size_t tail = atomic_load_explicit(&arena->tail, memory_order_acquire);
+	const size_t space = arena->size - (head - tail);
+	const size_t end = arena->size - (head & (arena->size - 1));
+	size_t avail;
+
+	if(end >= need)
+	{
+		arena->pending = head;
+		avail = (end < space) ? end : space;
+	}
+	else // not enough space left at end of buffer, wrap around
+	{
+		arena->pending = head + end;
+		avail = (space > end) ? space - end : 0;
+	}
 
-	return varchunk_write_request_max(handle->data.from_worker, size, max);
-}
+	if(avail < need)
+	{
+		return NULL;
+	}
 
-// non-rt
-static void
-_data_recv_adv(void *data, size_t written)
-{
-	plughandle_t *handle = data;
+	if(maximum)
+	{
+		*maximum = avail - sizeof(list_t);
+	}
 
-	varchunk_write_advance(handle->data.from_worker, written);
+	return (list_t *)(arena->buf + (arena->pending & (arena->size - 1)));
 }
 
-// non-rt
-static const void *
-_data_send_req(void *data, size_t *len)
+// producer
+static inline void
+_arena_write_advance(arena_t *arena, size_t written)
 {
-	plughandle_t *handle = data;
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_relaxed);
 
-	return varchunk_read_request(handle->data.to_worker, len);
-}
+	if(arena->pending != head)
+	{
+		list_t *g = (list_t *)(arena->buf + (head & (arena->size - 1)));
+		g->size = arena->pending - head - sizeof(list_t);
+		g->flags = LIST_GAP;
+	}
 
-// non-rt
-static void
-_data_send_adv(void *data)
-{
-	plughandle_t *handle = data;
+	list_t *l = (list_t *)(arena->buf + (arena->pending & (arena->size - 1)));
+	l->size = written;
+	l->flags = LIST_USED;
 
-	varchunk_read_advance(handle->data.to_worker);
+	atomic_store_explicit(&arena->head,
+		arena->pending + sizeof(list_t) + LIST_PAD(written), memory_order_release);
 }
 
-// rt
-static void
-_url_change(plughandle_t *handle, const char *url)
+// consumer with one read position per endpoint, next record targeted at it
+static inline list_t *
+_arena_peek(arena_t *arena, size_t *read, uint32_t target)
 {
-	LV2_OSC_Writer writer;
-	uint8_t buf [STR_LEN];
-	lv2_osc_writer_initialize(&writer, buf, STR_LEN);
-	lv2_osc_writer_message_vararg(&writer, "/eteroj/url", "s", url);
-	size_t size;
-	lv2_osc_writer_finalize(&writer, &size);
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+	const size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
 
-	if(size)
+	// everything before tail has been released already
+	if((ptrdiff_t)(tail - *read) > 0)
 	{
-		uint8_t *dst;
-		if((dst = varchunk_write_request(handle->data.to_thread, size))) //FIXME use request_max
+		*read = tail;
+	}
+
+	while(*read != head)
+	{
+		list_t *l = (list_t *)(arena->buf + (*read & (arena->size - 1)));
+
+		if( (l->flags == LIST_USED) && (l->tag & target) )
 		{
-			memcpy(dst, buf, size);
-			varchunk_write_advance(handle->data.to_thread, size);
+			return l;
 		}
+
+		*read += sizeof(list_t) + LIST_PAD(l->size);
 	}
+
+	return NULL;
 }
 
-static void
-_intercept(void *data, int64_t frames, props_impl_t *impl)
+// consumer, moves read position past record without releasing it
+static inline void
+_arena_next(arena_t *arena, size_t *read)
 {
-	plughandle_t *handle = data;
+	const list_t *l = (const list_t *)(arena->buf + (*read & (arena->size - 1)));
 
-	_url_change(handle, impl->value.body);
+	*read += sizeof(list_t) + LIST_PAD(l->size);
 }
 
-static const props_def_t defs [MAX_NPROPS] = {
-	{
-		.property = ETEROJ_URL_URI,
-		.offset = offsetof(plugstate_t, osc_url),
-		.type = LV2_ATOM__String,
-		.max_size = STR_LEN,
-		.event_cb = _intercept
-	},
-	{
-		.property = ETEROJ_ERROR_URI,
-		.offset = offsetof(plugstate_t, osc_error),
-		.access = LV2_PATCH__readable,
-		.type = LV2_ATOM__String,
-		.max_size = STR_LEN
-	},
-	{
-		.property = ETEROJ_CONNECTED_URI,
-		.offset = offsetof(plugstate_t, osc_connected),
-		.access = LV2_PATCH__readable,
-		.type = LV2_ATOM__Bool,
-	}
-};
-
-static LV2_Handle
-instantiate(const LV2_Descriptor* descriptor, double rate,
-	const char *bundle_path, const LV2_Feature *const *features)
+// consumer, releases record once all its targets are done and reclaims tail
+static inline void
+_arena_done(arena_t *arena, size_t *read, uint32_t target)
 {
-	plughandle_t *handle = calloc(1, sizeof(plughandle_t));
-	if(!handle)
+	list_t *l = (list_t *)(arena->buf + (*read & (arena->size - 1)));
+
+	*read += sizeof(list_t) + LIST_PAD(l->size);
+	l->tag &= ~target;
+
+	if(l->tag)
 	{
-		return NULL;
+		return;
 	}
 
-	mlock(handle, sizeof(plughandle_t));
+	l->flags = LIST_FREED;
 
-	for(unsigned i=0; features[i]; i++)
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
+
+	while(tail != head)
 	{
-		if(!strcmp(features[i]->URI, LV2_URID__map))
-		{
-			handle->map = features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_URID__unmap))
-		{
-			handle->unmap = features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_LOG__log))
-		{
-			handle->log = features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_OSC__schedule))
-		{
-			handle->osc_sched = features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_WORKER__schedule))
+		l = (list_t *)(arena->buf + (tail & (arena->size - 1)));
+
+		if(l->flags == LIST_USED)
 		{
-			handle->sched= features[i]->data;
+			break;
 		}
+
+		tail += sizeof(list_t) + LIST_PAD(l->size);
 	}
 
-	if(!handle->map || !handle->unmap)
+	atomic_store_explicit(&arena->tail, tail, memory_order_release);
+}
+
+// non-rt, arena sizes are powers of two
+static inline size_t
+_arena_size(plughandle_t *handle, int32_t kib)
+{
+	// default never falls below ARENA_SIZE, whatever the host's sequence size
+	const size_t want = (kib > 0)
+		? (size_t)kib << 10
+		: (handle->resize.preset > ARENA_SIZE) ? handle->resize.preset : ARENA_SIZE;
+	size_t size = ARENA_MIN;
+
+	while( (size < want) && (size < ARENA_MAX) )
 	{
-		fprintf(stderr,
-			"%s: Host does not support urid:(un)map\n", descriptor->URI);
-		free(handle);
-		return NULL;
+		size <<= 1;
 	}
-	if(!handle->sched)
+
+	return size;
+}
+
+// non-rt
+static inline unsigned
+_queue_size(int32_t size)
+{
+	if(size <= 0)
 	{
-		fprintf(stderr, "%s: Host does not support work:schedule\n", descriptor->URI);
-		free(handle);
-		return NULL;
+		return LIST_SIZE;
 	}
 
-	if(handle->log)
+	if(size < LIST_MIN)
 	{
-		lv2_log_logger_init(&handle->logger, handle->map, handle->log);
+		return LIST_MIN;
 	}
-	lv2_osc_urid_init(&handle->osc_urid, handle->map);
-	lv2_atom_forge_init(&handle->forge, handle->map);
 
-	// init data
-	handle->data.from_worker = varchunk_new(BUF_SIZE, true);
-	handle->data.to_worker = varchunk_new(BUF_SIZE, true);
-	handle->data.to_thread = varchunk_new(BUF_SIZE, true);
-	if(!handle->data.from_worker || !handle->data.to_worker || !handle->data.to_thread)
+	if(size > LIST_MAX)
 	{
-		free(handle);
-		return NULL;
+		return LIST_MAX;
 	}
 
-	handle->data.driver.write_req = _data_recv_req;
-	handle->data.driver.write_adv = _data_recv_adv;
-	handle->data.driver.read_req = _data_send_req;
-	handle->data.driver.read_adv = _data_send_adv;
+	return size;
+}
 
-	if(!props_init(&handle->props, descriptor->URI,
-		defs, MAX_NPROPS, &handle->state, &handle->stash,
-		handle->map, handle))
+static inline bool
+_arena_init(arena_t *arena, size_t size)
+{
+	arena->size = size;
+	arena->buf = malloc(size);
+	if(!arena->buf)
 	{
-		free(handle);
-		return NULL;
+		return false;
 	}
 
-	handle->uris.eteroj_connected = props_map(&handle->props, ETEROJ_CONNECTED_URI);
-	handle->uris.eteroj_error = props_map(&handle->props, ETEROJ_ERROR_URI);
+	mlock(arena->buf, size);
+	atomic_init(&arena->head, 0);
+	atomic_init(&arena->tail, 0);
 
-	return handle;
+	return true;
 }
 
-static void
-connect_port(LV2_Handle instance, uint32_t port, void *data)
+static inline void
+_arena_deinit(arena_t *arena)
 {
-	plughandle_t *handle = (plughandle_t *)instance;
-
-	switch(port)
+	if(arena->buf)
 	{
-		case 0:
-			handle->osc_in = (const LV2_Atom_Sequence *)data;
-			break;
-		case 1:
-			handle->osc_out = (LV2_Atom_Sequence *)data;
-			break;
-		default:
-			break;
+		munlock(arena->buf, arena->size);
+		free(arena->buf);
 	}
 }
 
-static inline list_t *
-_add_list(plughandle_t *handle)
+static inline bool
+_queue_init(queue_t *queue, size_t size, unsigned nheap)
 {
-	if(handle->nlist >= LIST_SIZE)
+	queue->size = nheap;
+	queue->heap = malloc(nheap * sizeof(sched_t));
+	if(!queue->heap)
 	{
-		return NULL;
+		return false;
 	}
 
-	return &handle->list[handle->nlist++];
+	mlock(queue->heap, nheap * sizeof(sched_t));
+
+	return _arena_init(&queue->arena, size);
 }
 
 static inline void
-_invalidate_list(list_t *list)
+_queue_deinit(queue_t *queue)
 {
-	list->size = 0; // invalidate
+	if(queue->heap)
+	{
+		munlock(queue->heap, queue->size * sizeof(sched_t));
+		free(queue->heap);
+	}
+
+	_arena_deinit(&queue->arena);
 }
 
-static int
-_cmp(const void *a, const void *b)
+// non-rt
+static void *
+_data_recv_req(void *data, size_t size, size_t *max)
 {
-	const list_t *A = a;
-	const list_t *B = b;
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
 
-	if(A->size && B->size)
-	{
-		if(A->frames < B->frames)
-		{
-			return -1;
-		}
-		else if(A->frames > B->frames)
-		{
-			return 1;
-		}
+	list_t *l = _arena_write_request(&handle->data.from_worker, size, max);
 
-		return 0;
-	}
-	else if(A->size)
+	if(!l)
 	{
-		return -1;
-	}
-	else if(B->size)
-	{
-		return 1;
+		return NULL;
 	}
 
-	return 0;
+	l->tag = ep->idx;
+
+	return l->buf;
 }
 
-static inline void
-_sort_list(plughandle_t *handle)
+// non-rt, largest packet incoming arena takes even after wrapping around
+static size_t
+_data_recv_max(void *data)
 {
-	qsort(handle->list, handle->nlist, sizeof(list_t), _cmp);
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
+
+	return handle->data.from_worker.size/2 - sizeof(list_t);
 }
 
-static inline void
-_parse(plughandle_t *handle, double frames, const uint8_t *buf, size_t size)
+// non-rt
+static void
+_data_recv_adv(void *data, size_t written)
 {
-	if(handle->ref)
-	{
-		handle->ref = lv2_atom_forge_frame_time(&handle->forge, frames);
-	}
-	if(handle->ref)
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
+
+	_arena_write_advance(&handle->data.from_worker, written);
+	atomic_fetch_add_explicit(&handle->traffic.received, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&handle->traffic.received_bytes, written, memory_order_relaxed);
+}
+
+// non-rt
+static const void *
+_data_send_req(void *data, size_t *len)
+{
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
+
+	const list_t *l = _arena_peek(&handle->data.to_worker, &ep->read, 1U << ep->idx);
+
+	if(!l)
 	{
-		handle->ref = lv2_osc_forge_packet(&handle->forge, &handle->osc_urid,
-			handle->map, buf, size);
+		return NULL;
 	}
+
+	ep->peek = ep->read;
+	*len = l->size;
+
+	return l->buf;
 }
 
-static inline void 
-_unroll(plughandle_t *handle, const uint8_t *buf, size_t size)
+// non-rt, packet following the one handed to stream last, which keeps them
+// queued until written
+static const void *
+_data_send_next(void *data, size_t *len)
 {
-	LV2_OSC_Reader reader;
-	lv2_osc_reader_initialize(&reader, buf, size);
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
+	arena_t *out = &handle->data.to_worker;
 
-	if(lv2_osc_reader_is_bundle(&reader))
+	_arena_next(out, &ep->peek);
+	const list_t *l = _arena_peek(out, &ep->peek, 1U << ep->idx);
+
+	if(!l)
 	{
-		LV2_OSC_Item *itm = OSC_READER_BUNDLE_BEGIN(&reader, size);
+		return NULL;
+	}
 
-		// immediate dispatch ?
-		if( (itm->timetag == LV2_OSC_IMMEDIATE) || !handle->osc_sched )
-		{
-			_parse(handle, 0.0, buf, size);
-		}
-		else if(size <= MTU_SIZE)
-		{
-			list_t *l = _add_list(handle);
-			if(l)
-			{
-				const double frames = handle->osc_sched->osc2frames(
-					handle->osc_sched->handle, itm->timetag);
+	*len = l->size;
 
-				l->frames = frames;
-				l->size = size;
-				memcpy(l->buf, buf, size);
+	return l->buf;
+}
+
+// non-rt
+static void
+_data_send_adv(void *data)
+{
+	endpoint_t *ep = data;
+	plughandle_t *handle = ep->handle;
+
+	// oldest packet handed to stream, arena may have been resized since
+	const list_t *l = _arena_peek(&handle->data.to_worker, &ep->read, 1U << ep->idx);
+
+	if(!l)
+	{
+		return;
+	}
+
+	atomic_fetch_add_explicit(&handle->traffic.sent, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&handle->traffic.sent_bytes, l->size,
+		memory_order_relaxed);
+
+	_arena_done(&handle->data.to_worker, &ep->read, 1U << ep->idx);
+}
+
+// non-rt
+static void *
+_prepare_recv_req(void *data, size_t size, size_t *max)
+{
+	(void)data;
+	(void)size;
+	(void)max;
+
+	return NULL; // leave received packets in socket until switched to
+}
+
+// non-rt
+static const void *
+_prepare_send_req(void *data, size_t *len)
+{
+	(void)data;
+	(void)len;
+
+	return NULL; // leave queued packets to current stream until switched to
+}
+
+// rt
+static void
+_url_change(plughandle_t *handle, const char *url)
+{
+	LV2_OSC_Writer writer;
+	uint8_t buf [STR_LEN + URL_LEN];
+	lv2_osc_writer_initialize(&writer, buf, sizeof(buf));
+	lv2_osc_writer_message_vararg(&writer, "/eteroj/url", "s", url);
+	size_t size;
+	lv2_osc_writer_finalize(&writer, &size);
+
+	if(size)
+	{
+		uint8_t *dst;
+		if((dst = varchunk_write_request(handle->data.to_thread, size))) //FIXME use request_max
+		{
+			memcpy(dst, buf, size);
+			varchunk_write_advance(handle->data.to_thread, size);
+			handle->wake.control = true;
+		}
+	}
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		handle->clock.remotes[i].locked = false; // new remotes, new clocks
+	}
+}
+
+// rt
+static void
+_threaded_change(plughandle_t *handle, int32_t threaded)
+{
+	LV2_OSC_Writer writer;
+	uint8_t buf [STR_LEN];
+	lv2_osc_writer_initialize(&writer, buf, STR_LEN);
+	lv2_osc_writer_message_vararg(&writer, "/eteroj/threaded", "i", threaded);
+	size_t size;
+	lv2_osc_writer_finalize(&writer, &size);
+
+	if(size)
+	{
+		uint8_t *dst;
+		if((dst = varchunk_write_request(handle->data.to_thread, size)))
+		{
+			memcpy(dst, buf, size);
+			varchunk_write_advance(handle->data.to_thread, size);
+			handle->wake.control = true;
+		}
+	}
+}
+
+// rt
+static void
+_resize_change(plughandle_t *handle)
+{
+	LV2_OSC_Writer writer;
+	uint8_t buf [STR_LEN];
+	lv2_osc_writer_initialize(&writer, buf, STR_LEN);
+	lv2_osc_writer_message_vararg(&writer, "/eteroj/resize", "ii",
+		handle->state.osc_buffer_size, handle->state.osc_queue_size);
+	size_t size;
+	lv2_osc_writer_finalize(&writer, &size);
+
+	if(size)
+	{
+		uint8_t *dst;
+		if((dst = varchunk_write_request(handle->data.to_thread, size)))
+		{
+			memcpy(dst, buf, size);
+			varchunk_write_advance(handle->data.to_thread, size);
+			handle->wake.control = true;
+		}
+	}
+}
+
+static void
+_intercept(void *data, int64_t frames, props_impl_t *impl)
+{
+	plughandle_t *handle = data;
+
+	_url_change(handle, impl->value.body);
+}
+
+static void
+_intercept_threaded(void *data, int64_t frames, props_impl_t *impl)
+{
+	plughandle_t *handle = data;
+
+	_threaded_change(handle, handle->state.osc_threaded);
+}
+
+static void
+_intercept_resize(void *data, int64_t frames, props_impl_t *impl)
+{
+	plughandle_t *handle = data;
+
+	_resize_change(handle);
+}
+
+static const props_def_t defs [MAX_NPROPS] = {
+	{
+		.property = ETEROJ_URL_URI,
+		.offset = offsetof(plugstate_t, osc_url),
+		.type = LV2_ATOM__String,
+		.max_size = URL_LEN,
+		.event_cb = _intercept
+	},
+	{
+		.property = ETEROJ_ERROR_URI,
+		.offset = offsetof(plugstate_t, osc_error),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__String,
+		.max_size = STR_LEN
+	},
+	{
+		.property = ETEROJ_CONNECTED_URI,
+		.offset = offsetof(plugstate_t, osc_connected),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Bool,
+	},
+	{
+		.property = ETEROJ_THREADED_URI,
+		.offset = offsetof(plugstate_t, osc_threaded),
+		.type = LV2_ATOM__Bool,
+		.event_cb = _intercept_threaded
+	},
+	{
+		.property = ETEROJ_PEERS_URI,
+		.offset = offsetof(plugstate_t, osc_peers),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Int,
+	},
+	{
+		.property = ETEROJ_SENT_URI,
+		.offset = offsetof(plugstate_t, osc_sent),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_RECEIVED_URI,
+		.offset = offsetof(plugstate_t, osc_received),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_SCHEDULE_URI,
+		.offset = offsetof(plugstate_t, osc_schedule),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = ETEROJ_LEAD_URI,
+		.offset = offsetof(plugstate_t, osc_lead),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = ETEROJ_COALESCE_URI,
+		.offset = offsetof(plugstate_t, osc_coalesce),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = ETEROJ_MTU_URI,
+		.offset = offsetof(plugstate_t, osc_mtu),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = ETEROJ_PACKING_URI,
+		.offset = offsetof(plugstate_t, osc_packing),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = ETEROJ_SENT_BYTES_URI,
+		.offset = offsetof(plugstate_t, osc_sent_bytes),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_RECEIVED_BYTES_URI,
+		.offset = offsetof(plugstate_t, osc_received_bytes),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_DROP_INPUT_URI,
+		.offset = offsetof(plugstate_t, osc_drop_input),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_DROP_OUTPUT_URI,
+		.offset = offsetof(plugstate_t, osc_drop_output),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_DROP_NETWORK_URI,
+		.offset = offsetof(plugstate_t, osc_drop_network),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_LATE_URI,
+		.offset = offsetof(plugstate_t, osc_late),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Long,
+	},
+	{
+		.property = ETEROJ_LATE_HISTOGRAM_URI,
+		.offset = offsetof(plugstate_t, osc_late_histogram),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Vector,
+		.max_size = sizeof(((plugstate_t *)0)->osc_late_histogram)
+	},
+	{
+		.property = ETEROJ_QUEUE_PEAK_URI,
+		.offset = offsetof(plugstate_t, osc_queue_peak),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Int,
+	},
+	{
+		.property = ETEROJ_FILL_INPUT_URI,
+		.offset = offsetof(plugstate_t, osc_fill_input),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float,
+	},
+	{
+		.property = ETEROJ_FILL_OUTPUT_URI,
+		.offset = offsetof(plugstate_t, osc_fill_output),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float,
+	},
+	{
+		.property = ETEROJ_CLOCK_URI,
+		.offset = offsetof(plugstate_t, osc_clock),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = ETEROJ_OFFSET_URI,
+		.offset = offsetof(plugstate_t, osc_offset),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float,
+	},
+	{
+		.property = ETEROJ_JITTER_URI,
+		.offset = offsetof(plugstate_t, osc_jitter),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float,
+	},
+	{
+		.property = ETEROJ_SWITCH_TIME_URI,
+		.offset = offsetof(plugstate_t, osc_switch_time),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Float,
+	},
+	{
+		.property = ETEROJ_BUFFER_SIZE_URI,
+		.offset = offsetof(plugstate_t, osc_buffer_size),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_resize
+	},
+	{
+		.property = ETEROJ_QUEUE_SIZE_URI,
+		.offset = offsetof(plugstate_t, osc_queue_size),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_resize
+	},
+	{
+		.property = ETEROJ_WAKEUPS_URI,
+		.offset = offsetof(plugstate_t, osc_wakeups),
+		.access = LV2_PATCH__readable,
+		.type = LV2_ATOM__Int,
+	}
+};
+
+static LV2_Handle
+instantiate(const LV2_Descriptor* descriptor, double rate,
+	const char *bundle_path, const LV2_Feature *const *features)
+{
+	plughandle_t *handle = calloc(1, sizeof(plughandle_t));
+	if(!handle)
+	{
+		return NULL;
+	}
+
+	mlock(handle, sizeof(plughandle_t));
+
+	for(unsigned i=0; features[i]; i++)
+	{
+		if(!strcmp(features[i]->URI, LV2_URID__map))
+		{
+			handle->map = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_URID__unmap))
+		{
+			handle->unmap = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_LOG__log))
+		{
+			handle->log = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_OSC__schedule))
+		{
+			handle->osc_sched = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_WORKER__schedule))
+		{
+			handle->sched= features[i]->data;
+		}
+	}
+
+	if(!handle->map || !handle->unmap)
+	{
+		fprintf(stderr,
+			"%s: Host does not support urid:(un)map\n", descriptor->URI);
+		free(handle);
+		return NULL;
+	}
+	if(!handle->sched)
+	{
+		fprintf(stderr, "%s: Host does not support work:schedule\n", descriptor->URI);
+		free(handle);
+		return NULL;
+	}
+
+	if(handle->log)
+	{
+		lv2_log_logger_init(&handle->logger, handle->map, handle->log);
+	}
+	lv2_osc_urid_init(&handle->osc_urid, handle->map);
+	lv2_atom_forge_init(&handle->forge, handle->map);
+
+	// init data, arenas are resized on worker upon changes of buffer_size
+	handle->resize.preset = eteroj_ring_size(features, handle->map,
+		ARENA_SEQUENCES, ARENA_SIZE);
+	handle->resize.arena = _arena_size(handle, 0);
+	handle->resize.queue = _queue_size(0);
+	atomic_init(&handle->resize.state, RESIZE_IDLE);
+	atomic_init(&handle->resize.compact, false);
+
+	handle->data.to_thread = varchunk_new(BUF_SIZE, true);
+	if(!handle->data.to_thread
+		|| !_arena_init(&handle->data.to_worker, handle->resize.arena)
+		|| !_arena_init(&handle->data.from_worker, handle->resize.arena)
+		|| !_queue_init(&handle->rx, handle->resize.arena, handle->resize.queue)
+		|| !_queue_init(&handle->tx, handle->resize.arena, handle->resize.queue) )
+	{
+		free(handle);
+		return NULL;
+	}
+
+	handle->io.efd = -1;
+	handle->io.epfd = -1;
+#if defined(__linux__)
+	handle->io.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	handle->io.epfd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+	atomic_init(&handle->io.active, false);
+	atomic_init(&handle->io.wakers, 0);
+	atomic_init(&handle->io.done, false);
+	atomic_init(&handle->io.ev, LV2_OSC_NONE);
+	atomic_init(&handle->io.connected, false);
+	atomic_init(&handle->traffic.peers, 0);
+	atomic_init(&handle->traffic.sent, 0);
+	atomic_init(&handle->traffic.received, 0);
+	atomic_init(&handle->traffic.sent_bytes, 0);
+	atomic_init(&handle->traffic.received_bytes, 0);
+	atomic_init(&handle->traffic.drop_network, 0);
+	atomic_init(&handle->traffic.switch_time, 0);
+	handle->traffic.period = rate; // 1s
+	handle->rate = rate;
+	atomic_init(&handle->wake.pending, true);
+	handle->wake.interval = rate * IO_TIMEOUT_MS / 1000;
+
+	handle->data.driver.write_req = _data_recv_req;
+	handle->data.driver.write_adv = _data_recv_adv;
+	handle->data.driver.read_req = _data_send_req;
+	handle->data.driver.read_adv = _data_send_adv;
+	handle->data.driver.read_next = _data_send_next;
+	handle->data.driver.write_max = _data_recv_max;
+
+	handle->data.prepare.write_req = _prepare_recv_req;
+	handle->data.prepare.write_adv = _data_recv_adv;
+	handle->data.prepare.read_req = _prepare_send_req;
+	handle->data.prepare.read_adv = _data_send_adv;
+	handle->data.prepare.read_next = _prepare_send_req;
+	handle->data.prepare.write_max = _data_recv_max;
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+		char uri [STR_LEN];
+
+		snprintf(uri, sizeof(uri), "%s_%u", ETEROJ_ENDPOINT_URI, i + 1);
+
+		ep->handle = handle;
+		ep->idx = i;
+		handle->uris.eteroj_endpoint[i] = handle->map->map(handle->map->handle, uri);
+	}
+	atomic_init(&handle->data.configured, 0);
+	lv2_atom_sequence_clear(&handle->defer.seq);
+	handle->data.targets = 1U << 0;
+
+	if(!props_init(&handle->props, descriptor->URI,
+		defs, MAX_NPROPS, &handle->state, &handle->stash,
+		handle->map, handle))
+	{
+		free(handle);
+		return NULL;
+	}
+
+	handle->uris.eteroj_connected = props_map(&handle->props, ETEROJ_CONNECTED_URI);
+	handle->uris.eteroj_error = props_map(&handle->props, ETEROJ_ERROR_URI);
+	handle->uris.eteroj_peers = props_map(&handle->props, ETEROJ_PEERS_URI);
+	handle->uris.eteroj_sent = props_map(&handle->props, ETEROJ_SENT_URI);
+	handle->uris.eteroj_received = props_map(&handle->props, ETEROJ_RECEIVED_URI);
+	handle->uris.eteroj_packing = props_map(&handle->props, ETEROJ_PACKING_URI);
+	handle->uris.eteroj_sent_bytes = props_map(&handle->props, ETEROJ_SENT_BYTES_URI);
+	handle->uris.eteroj_received_bytes = props_map(&handle->props, ETEROJ_RECEIVED_BYTES_URI);
+	handle->uris.eteroj_drop_input = props_map(&handle->props, ETEROJ_DROP_INPUT_URI);
+	handle->uris.eteroj_drop_output = props_map(&handle->props, ETEROJ_DROP_OUTPUT_URI);
+	handle->uris.eteroj_drop_network = props_map(&handle->props, ETEROJ_DROP_NETWORK_URI);
+	handle->uris.eteroj_late = props_map(&handle->props, ETEROJ_LATE_URI);
+	handle->uris.eteroj_late_histogram = props_map(&handle->props, ETEROJ_LATE_HISTOGRAM_URI);
+	handle->uris.eteroj_queue_peak = props_map(&handle->props, ETEROJ_QUEUE_PEAK_URI);
+	handle->uris.eteroj_fill_input = props_map(&handle->props, ETEROJ_FILL_INPUT_URI);
+	handle->uris.eteroj_fill_output = props_map(&handle->props, ETEROJ_FILL_OUTPUT_URI);
+	handle->uris.eteroj_offset = props_map(&handle->props, ETEROJ_OFFSET_URI);
+	handle->uris.eteroj_jitter = props_map(&handle->props, ETEROJ_JITTER_URI);
+	handle->uris.eteroj_switch_time = props_map(&handle->props, ETEROJ_SWITCH_TIME_URI);
+	handle->uris.eteroj_wakeups = props_map(&handle->props, ETEROJ_WAKEUPS_URI);
+
+	// histogram has fixed size, bins are filled in by _traffic_update
+	handle->state.osc_late_histogram.body.child_size = sizeof(int64_t);
+	handle->state.osc_late_histogram.body.child_type = handle->forge.Long;
+	_props_impl_get(&handle->props, handle->uris.eteroj_late_histogram)->value.size
+		= sizeof(handle->state.osc_late_histogram);
+
+	handle->state.osc_mtu = MTU_DEFAULT;
+
+	return handle;
+}
+
+static void
+connect_port(LV2_Handle instance, uint32_t port, void *data)
+{
+	plughandle_t *handle = (plughandle_t *)instance;
+
+	switch(port)
+	{
+		case 0:
+			handle->osc_in = (const LV2_Atom_Sequence *)data;
+			break;
+		case 1:
+			handle->osc_out = (LV2_Atom_Sequence *)data;
+			break;
+		default:
+			break;
+	}
+}
+
+static inline list_t *
+_get_list(arena_t *arena, uint32_t off)
+{
+	return (list_t *)(arena->buf + off);
+}
+
+// consumer
+static inline list_t *
+_arena_read_request(arena_t *arena, uint32_t *off)
+{
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+
+	while(arena->read != head)
+	{
+		*off = arena->read & (arena->size - 1);
+		list_t *l = _get_list(arena, *off);
+
+		arena->read += sizeof(list_t) + LIST_PAD(l->size);
+
+		if(l->flags != LIST_GAP)
+		{
+			return l;
+		}
+	}
+
+	return NULL;
+}
+
+// consumer, reclaims released records and gaps at tail
+static inline void
+_arena_reclaim(arena_t *arena)
+{
+	size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
+
+	while(tail != arena->read)
+	{
+		const list_t *l = _get_list(arena, tail & (arena->size - 1));
+
+		if(l->flags == LIST_USED)
+		{
+			break;
+		}
+
+		tail += sizeof(list_t) + LIST_PAD(l->size);
+	}
+
+	atomic_store_explicit(&arena->tail, tail, memory_order_release);
+}
+
+// consumer, more than half of the ring is taken, released records included
+static inline bool
+_arena_crowded(arena_t *arena)
+{
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+	const size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
+
+	return (head - tail) > (arena->size >> 1);
+}
+
+// consumer
+static inline void
+_invalidate_list(arena_t *arena, uint32_t off)
+{
+	_get_list(arena, off)->flags = LIST_FREED; // invalidate
+
+	_arena_reclaim(arena);
+}
+
+// non-rt, bytes taken by records still in use
+static inline size_t
+_arena_used(arena_t *arena)
+{
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+	size_t pos = atomic_load_explicit(&arena->tail, memory_order_acquire);
+	size_t used = 0;
+
+	while(pos != head)
+	{
+		const list_t *l = _get_list(arena, pos & (arena->size - 1));
+		const size_t len = sizeof(list_t) + LIST_PAD(l->size);
+
+		if(l->flags == LIST_USED)
+		{
+			used += len;
+		}
+
+		pos += len;
+	}
+
+	return used;
+}
+
+// non-rt, moves records still in use to the start of a new buffer and remaps
+// their heap slots, neither producer nor consumer may touch the arena
+static inline void
+_arena_move(arena_t *arena, uint8_t *buf, size_t size, sched_t *heap)
+{
+	const size_t head = atomic_load_explicit(&arena->head, memory_order_acquire);
+	size_t pos = atomic_load_explicit(&arena->tail, memory_order_acquire);
+	size_t dst = 0;
+	size_t read = 0;
+
+	while(pos != head)
+	{
+		list_t *l = _get_list(arena, pos & (arena->size - 1));
+		const size_t len = sizeof(list_t) + LIST_PAD(l->size);
+
+		if(pos == arena->read)
+		{
+			read = dst;
+			heap = NULL; // records not unrolled yet are not scheduled
+		}
+
+		if(l->flags == LIST_USED)
+		{
+			memcpy(buf + dst, l, len);
+
+			if(heap)
+			{
+				heap[l->slot].off = dst;
+			}
+
+			dst += len;
+		}
+
+		pos += len;
+	}
+
+	if(pos == arena->read)
+	{
+		read = dst;
+	}
+
+	_arena_deinit(arena);
+
+	arena->buf = buf;
+	arena->size = size;
+	arena->read = read;
+	atomic_store_explicit(&arena->head, dst, memory_order_release);
+	atomic_store_explicit(&arena->tail, 0, memory_order_release);
+}
+
+static inline bool
+_sched_before(const sched_t *A, const sched_t *B)
+{
+	if(A->timetag != B->timetag)
+	{
+		return A->timetag < B->timetag;
+	}
+
+	return (int32_t)(A->seq - B->seq) < 0; // wrap-around safe
+}
+
+// keeps the record's back-pointer in sync, so it can be moved in O(1)
+static inline void
+_sched_set(queue_t *queue, unsigned i, const sched_t *itm)
+{
+	queue->heap[i] = *itm;
+	_get_list(itm->arena, itm->off)->slot = i;
+}
+
+static inline void
+_sched_push(queue_t *queue, uint64_t timetag, arena_t *arena, uint32_t off)
+{
+	sched_t *heap = queue->heap;
+	unsigned i = queue->nheap++;
+	const sched_t itm = {
+		.timetag = timetag,
+		.seq = queue->seq++,
+		.off = off,
+		.arena = arena
+	};
+
+	// sift up
+	while(i > 0)
+	{
+		const unsigned parent = (i - 1) / 2;
+
+		if(!_sched_before(&itm, &heap[parent]))
+		{
+			break;
+		}
+
+		_sched_set(queue, i, &heap[parent]);
+		i = parent;
+	}
+
+	_sched_set(queue, i, &itm);
+}
+
+static inline void
+_sched_pop(queue_t *queue)
+{
+	sched_t *heap = queue->heap;
+	const unsigned n = --queue->nheap;
+	const sched_t itm = heap[n];
+	unsigned i = 0;
+
+	// sift down
+	while(true)
+	{
+		unsigned child = 2*i + 1;
+
+		if(child >= n)
+		{
+			break;
+		}
+
+		if( (child + 1 < n) && _sched_before(&heap[child + 1], &heap[child]) )
+		{
+			child++;
+		}
+
+		if(!_sched_before(&heap[child], &itm))
+		{
+			break;
+		}
+
+		_sched_set(queue, i, &heap[child]);
+		i = child;
+	}
+
+	if(i < n)
+	{
+		_sched_set(queue, i, &itm);
+	}
+}
+
+// rt, commits record requested from the queue's arena and tells its offset
+static inline uint32_t
+_queue_commit(queue_t *queue, size_t written)
+{
+	arena_t *arena = &queue->arena;
+	const uint32_t off = arena->pending & (arena->size - 1);
+
+	_arena_write_advance(arena, written);
+	arena->read = atomic_load_explicit(&arena->head, memory_order_relaxed); // rt is consumer, too
+	queue->used += sizeof(list_t) + LIST_PAD(written);
+
+	return off;
+}
+
+// rt, moves record at the tail, still in use, to the head and remaps its heap slot
+static inline bool
+_queue_move(queue_t *queue)
+{
+	arena_t *arena = &queue->arena;
+	const size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
+	const uint32_t from = tail & (arena->size - 1);
+	const list_t *t = _get_list(arena, from);
+	list_t *m = _arena_write_request(arena, t->size, NULL);
+
+	if(!m)
+	{
+		return false;
+	}
+
+	memcpy(m->buf, t->buf, t->size);
+	m->tag = t->tag;
+	m->slot = t->slot;
+	queue->heap[t->slot].off = _queue_commit(queue, t->size);
+	queue->used -= sizeof(list_t) + LIST_PAD(t->size);
+	_invalidate_list(arena, from);
+
+	return true;
+}
+
+// rt, queued records are released in timetag order, records at the tail still
+// in use are moved to the head while the arena is crowded or a request fails,
+// e.g. a far-future bundle never pins the arena, moves per call are bounded
+// to twice the request or a single record, the rest is left to later calls or
+// to the worker, when there is no room left to move records to
+static inline list_t *
+_queue_request(queue_t *queue, size_t minimum)
+{
+	arena_t *arena = &queue->arena;
+	const size_t need = sizeof(list_t) + LIST_PAD(minimum);
+	const size_t budget = 2*need;
+	size_t moved = 0;
+
+	_arena_reclaim(arena); // tail is a record in use from here on, if any
+
+	while(true)
+	{
+		const size_t head = atomic_load_explicit(&arena->head, memory_order_relaxed);
+		const size_t tail = atomic_load_explicit(&arena->tail, memory_order_relaxed);
+		const bool crowded = (head - tail) > (arena->size >> 1);
+
+		if(!crowded)
+		{
+			list_t *l = _arena_write_request(arena, minimum, NULL);
+
+			if(l || (tail == head))
+			{
+				return l;
+			}
+		}
+
+		const list_t *t = _get_list(arena, tail & (arena->size - 1));
+		const size_t len = sizeof(list_t) + LIST_PAD(t->size);
+
+		if( (moved && (moved + len > budget)) || !_queue_move(queue) )
+		{
+			list_t *l = _arena_write_request(arena, minimum, NULL);
+
+			if(!l && (queue->used + need <= (arena->size >> 1)) )
+			{
+				queue->pinned = true;
+			}
+
+			return l;
+		}
+
+		moved += len;
+	}
+}
+
+// rt, schedules record filled after _queue_request
+static inline void
+_queue_push(queue_t *queue, size_t written, uint64_t timetag)
+{
+	const uint32_t off = _queue_commit(queue, written);
+
+	_sched_push(queue, timetag, &queue->arena, off);
+}
+
+// rt, moves record at the tail of the ring it was received in, still
+// scheduled, to the queue's arena, so the ring is not pinned by it
+static inline bool
+_queue_relocate(queue_t *queue, arena_t *ring)
+{
+	_arena_reclaim(ring);
+
+	const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if(tail == ring->read) // nothing scheduled at tail
+	{
+		return false;
+	}
+
+	const uint32_t from = tail & (ring->size - 1);
+	const list_t *t = _get_list(ring, from);
+	list_t *m = _queue_request(queue, t->size);
+
+	if(!m)
+	{
+		return false;
+	}
+
+	memcpy(m->buf, t->buf, t->size);
+	m->tag = t->tag;
+	m->slot = t->slot;
+	sched_t *itm = &queue->heap[t->slot];
+	itm->off = _queue_commit(queue, t->size);
+	itm->arena = &queue->arena;
+	_invalidate_list(ring, from);
+
+	return true;
+}
+
+// rt, releases record of earliest bundle
+static inline void
+_queue_pop(queue_t *queue)
+{
+	const sched_t *top = &queue->heap[0];
+
+	if(top->arena == &queue->arena)
+	{
+		queue->used -= sizeof(list_t) + LIST_PAD(_get_list(top->arena, top->off)->size);
+	}
+
+	_invalidate_list(top->arena, top->off);
+	_sched_pop(queue);
+}
+
+#undef LIST_PAD
+
+// received packets carry their source endpoint as object subject
+static inline void
+_parse(plughandle_t *handle, double frames, const list_t *l)
+{
+	if(handle->ref)
+	{
+		handle->ref = lv2_atom_forge_frame_time(&handle->forge, frames);
+	}
+	if(handle->ref)
+	{
+		const uint32_t offset = handle->forge.offset;
+
+		handle->ref = lv2_osc_forge_packet(&handle->forge, &handle->osc_urid,
+			handle->map, l->buf, l->size);
+
+		if(handle->ref)
+		{
+			LV2_Atom_Object *obj = (LV2_Atom_Object *)(handle->forge.buf + offset);
+
+			obj->body.id = handle->uris.eteroj_endpoint[l->tag];
+		}
+	}
+}
+
+// rt, measures lateness and corrects timetag by estimated offset of the
+// source endpoint's clock if enabled
+static inline uint64_t
+_clock_correct(plughandle_t *handle, unsigned idx, uint64_t timetag)
+{
+	remote_t *remote = &handle->clock.remotes[idx];
+	const double late = (double)(int64_t)(handle->clock.now - timetag) / 0x1p32;
+
+	if(!remote->samples || (late > remote->late))
+	{
+		remote->late = late;
+	}
+	remote->samples += 1;
+
+	if(!handle->state.osc_clock || !remote->locked)
+	{
+		return timetag;
+	}
+
+	// only ever delay, bundles sent ahead of time are left alone
+	const double correction = remote->offset + CLOCK_MARGIN*remote->jitter;
+
+	if(correction <= 0.0)
+	{
+		return timetag;
+	}
+
+	return timetag + (uint64_t)(correction * 0x1p32);
+}
+
+// rt, second order delay-locked loop on offset and drift of each endpoint
+static inline void
+_clock_update(plughandle_t *handle, double period)
+{
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		remote_t *remote = &handle->clock.remotes[i];
+
+		remote->elapsed += period;
+
+		if(!remote->samples)
+		{
+			continue;
+		}
+
+		if(!remote->locked)
+		{
+			remote->offset = remote->late;
+			remote->drift = 0.0;
+			remote->jitter = 0.0;
+			remote->locked = true;
+		}
+		else
+		{
+			const double dt = remote->elapsed;
+			double omega = 2.0 * M_PI * CLOCK_BANDWIDTH * dt;
+
+			if(omega > 0.5) // keep loop stable for sparse bundles
+			{
+				omega = 0.5;
+			}
+
+			const double predicted = remote->offset + remote->drift*dt;
+			const double err = remote->late - predicted;
+
+			remote->offset = predicted + M_SQRT2*omega*err;
+			remote->drift += omega*omega*err / dt;
+			remote->jitter += (fabs(err) - remote->jitter) * CLOCK_JITTER_WEIGHT;
+		}
+
+		remote->elapsed = 0.0;
+		remote->samples = 0;
+	}
+}
+
+// scheduled bundles stay in the ring until dispatched, heap only keeps offsets
+static inline void
+_unroll(plughandle_t *handle, const list_t *l, uint32_t off)
+{
+	arena_t *ring = &handle->data.from_worker;
+
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, l->buf, l->size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		LV2_OSC_Item *itm = OSC_READER_BUNDLE_BEGIN(&reader, l->size);
+
+		// immediate dispatch ?
+		if( (itm->timetag == LV2_OSC_IMMEDIATE) || !handle->osc_sched )
+		{
+			_parse(handle, 0.0, l);
+		}
+		else if(handle->rx.nheap < handle->rx.size)
+		{
+			_sched_push(&handle->rx, _clock_correct(handle, l->tag, itm->timetag), ring, off);
+
+			if(handle->rx.nheap > handle->stats.queue_peak)
+			{
+				handle->stats.queue_peak = handle->rx.nheap;
+			}
+
+			return; // released when dispatched
+		}
+		else
+		{
+			handle->stats.drop_input += 1; // message pool overflow
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader)) // immediate dispatch
+	{
+		_parse(handle, 0.0, l);
+	}
+
+	_invalidate_list(ring, off);
+}
+
+// rt, events with an endpoint as object subject are sent there only
+static inline uint32_t
+_targets(plughandle_t *handle, const LV2_Atom_Object *obj)
+{
+	if(obj->body.id)
+	{
+		for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+		{
+			if(obj->body.id == handle->uris.eteroj_endpoint[i])
+			{
+				return 1U << i;
+			}
+		}
+	}
+
+	return handle->data.targets;
+}
+
+// rt
+static inline bool
+_send(plughandle_t *handle, const uint8_t *buf, size_t size, uint32_t targets)
+{
+	list_t *l;
+
+	if((l = _arena_write_request(&handle->data.to_worker, size, NULL)))
+	{
+		memcpy(l->buf, buf, size);
+		l->tag = targets;
+		_arena_write_advance(&handle->data.to_worker, size);
+
+		return true;
+	}
+
+	return false;
+}
+
+// rt
+static inline bool
+_coalesce_flush(plughandle_t *handle)
+{
+	bool queued = false;
+
+	if(handle->coalesce.dst)
+	{
+		if(handle->coalesce.items)
+		{
+			size_t written;
+			lv2_osc_writer_finalize(&handle->coalesce.writer, &written);
+			_arena_write_advance(&handle->data.to_worker, written);
+
+			handle->coalesce.packets += 1;
+			queued = true;
+		}
+
+		handle->coalesce.dst = NULL;
+	}
+
+	return queued;
+}
+
+// rt
+static inline bool
+_coalesce_open(plughandle_t *handle, int64_t frames, uint32_t targets)
+{
+	const uint64_t timetag = handle->osc_sched
+		? handle->osc_sched->frames2osc(handle->osc_sched->handle, frames)
+		: LV2_OSC_IMMEDIATE;
+	size_t mtu = handle->state.osc_mtu;
+
+	if(mtu < MTU_MIN)
+	{
+		mtu = MTU_MIN;
+	}
+	else if(mtu > MTU_MAX)
+	{
+		mtu = MTU_MAX;
+	}
+
+	list_t *l = _arena_write_request(&handle->data.to_worker, mtu, NULL);
+
+	if(!l)
+	{
+		return false;
+	}
+
+	l->tag = targets;
+	handle->coalesce.dst = l->buf;
+	handle->coalesce.targets = targets;
+
+	lv2_osc_writer_initialize(&handle->coalesce.writer, handle->coalesce.dst, mtu);
+	lv2_osc_writer_push_bundle(&handle->coalesce.writer, &handle->coalesce.bndl, timetag);
+	handle->coalesce.frames = frames;
+	handle->coalesce.items = 0;
+
+	return true;
+}
+
+// rt, messages off the bundle's frame are nested in a bundle with own timetag
+static inline bool
+_coalesce_append(plughandle_t *handle, int64_t frames, const LV2_Atom_Object *obj)
+{
+	LV2_OSC_Writer *writer = &handle->coalesce.writer;
+	uint8_t *ptr = writer->ptr;
+	LV2_OSC_Writer_Frame itm;
+
+	if(handle->osc_sched && (frames != handle->coalesce.frames))
+	{
+		const uint64_t timetag = handle->osc_sched->frames2osc(
+			handle->osc_sched->handle, frames);
+		LV2_OSC_Writer_Frame bndl;
+		LV2_OSC_Writer_Frame sub;
+
+		if(  lv2_osc_writer_push_item(writer, &itm)
+			&& lv2_osc_writer_push_bundle(writer, &bndl, timetag)
+			&& lv2_osc_writer_push_item(writer, &sub)
+			&& lv2_osc_writer_packet(writer, &handle->osc_urid, handle->unmap, obj->atom.size, &obj->body)
+			&& lv2_osc_writer_pop_item(writer, &sub)
+			&& lv2_osc_writer_pop_bundle(writer, &bndl)
+			&& lv2_osc_writer_pop_item(writer, &itm) )
+		{
+			return true;
+		}
+	}
+	else if(lv2_osc_writer_push_item(writer, &itm)
+		&& lv2_osc_writer_packet(writer, &handle->osc_urid, handle->unmap, obj->atom.size, &obj->body)
+		&& lv2_osc_writer_pop_item(writer, &itm) )
+	{
+		return true;
+	}
+
+	writer->ptr = ptr; // roll back
+	return false;
+}
+
+// rt, returns false for messages too large for an MTU sized bundle
+static inline bool
+_coalesce(plughandle_t *handle, int64_t frames, const LV2_Atom_Object *obj,
+	uint32_t targets)
+{
+	if(!handle->coalesce.dst || (handle->coalesce.targets != targets)
+		|| !_coalesce_append(handle, frames, obj) )
+	{
+		_coalesce_flush(handle);
+
+		if(!_coalesce_open(handle, frames, targets))
+		{
+			return false;
+		}
+
+		if(!_coalesce_append(handle, frames, obj))
+		{
+			handle->coalesce.dst = NULL;
+			return false;
+		}
+	}
+
+	handle->coalesce.items += 1;
+	handle->coalesce.messages += 1;
+
+	return true;
+}
+
+// rt, outgoing bundles are held in the queue's arena until due, which moves
+// the ones not due for long out of the way of later ones
+static inline void
+_hold(plughandle_t *handle, const LV2_Atom_Object *obj, uint32_t targets)
+{
+	queue_t *tx = &handle->tx;
+	const size_t reserve = obj->atom.size;
+	list_t *l;
+
+	if( (tx->nheap >= tx->size)
+		|| !(l = _queue_request(tx, reserve)) )
+	{
+		handle->stats.drop_output += 1; // output pool overflow
+		return;
+	}
+
+	LV2_OSC_Writer writer;
+	lv2_osc_writer_initialize(&writer, l->buf, reserve);
+	lv2_osc_writer_packet(&writer, &handle->osc_urid, handle->unmap, obj->atom.size, &obj->body);
+	size_t written;
+	lv2_osc_writer_finalize(&writer, &written);
+
+	if(!written)
+	{
+		return;
+	}
+
+	l->tag = targets;
+
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, l->buf, written);
+	LV2_OSC_Item *itm = OSC_READER_BUNDLE_BEGIN(&reader, written);
+
+	_queue_push(tx, written, itm->timetag);
+}
+
+// rt, holds, coalesces or queues an outgoing event, tells whether it is queued
+static inline bool
+_output(plughandle_t *handle, int64_t frames, const LV2_Atom_Object *obj)
+{
+	const uint32_t targets = _targets(handle, obj);
+
+	if( handle->state.osc_schedule && handle->osc_sched
+		&& lv2_osc_is_bundle_type(&handle->osc_urid, obj->body.otype) )
+	{
+		_hold(handle, obj, targets);
+		return false;
+	}
+
+	const bool message = lv2_osc_is_message_type(&handle->osc_urid, obj->body.otype);
+
+	if( message && handle->state.osc_coalesce
+		&& _coalesce(handle, frames, obj, targets) )
+	{
+		return true;
+	}
+
+	_coalesce_flush(handle);
+
+	list_t *l;
+	size_t reserve = obj->atom.size;
+	if((l = _arena_write_request(&handle->data.to_worker, reserve, NULL)))
+	{
+		LV2_OSC_Writer writer;
+		lv2_osc_writer_initialize(&writer, l->buf, reserve);
+		lv2_osc_writer_packet(&writer, &handle->osc_urid, handle->unmap, obj->atom.size, &obj->body);
+		size_t written;
+		lv2_osc_writer_finalize(&writer, &written);
+
+		if(written)
+		{
+			l->tag = targets;
+			_arena_write_advance(&handle->data.to_worker, written);
+
+			if(message)
+			{
+				handle->coalesce.messages += 1;
+				handle->coalesce.packets += 1;
+			}
+
+			return true;
+		}
+	}
+	else
+	{
+		handle->stats.drop_output += 1; // output ringbuffer overflow
+	}
+
+	return false;
+}
+
+// rt
+static inline bool
+_release(plughandle_t *handle, uint32_t nsamples)
+{
+	queue_t *tx = &handle->tx;
+	const bool scheduled = handle->state.osc_schedule && handle->osc_sched;
+	const double lead = handle->state.osc_lead * handle->rate / 1000.0;
+	bool queued = false;
+
+	while(tx->nheap)
+	{
+		const sched_t *top = &tx->heap[0];
+		const list_t *l = _get_list(top->arena, top->off);
+
+		// send all right away when scheduling has been switched off
+		if(scheduled)
+		{
+			const double frames = handle->osc_sched->osc2frames(handle->osc_sched->handle,
+				top->timetag) - lead;
+
+			if(frames >= nsamples) // not due in this period
+			{
+				break;
+			}
+		}
+
+		if(!_send(handle, l->buf, l->size, l->tag))
+		{
+			break; // retry in next period
+		}
+
+		queued = true;
+		_queue_pop(tx);
+	}
+
+	return queued;
+}
+
+// rt
+static inline void
+_late(plughandle_t *handle, double frames)
+{
+	unsigned bin = 0;
+
+	while( (bin < LATE_BINS - 1) && (frames >= (16U << (2*bin))) )
+	{
+		bin++;
+	}
+
+	handle->stats.late += 1;
+	handle->stats.late_bins[bin] += 1;
+}
+
+// rt
+static inline void
+_stats_update(plughandle_t *handle, uint32_t frames)
+{
+	LV2_Atom_Forge *forge = &handle->forge;
+	plugstate_t *state = &handle->state;
+
+	const int64_t sent_bytes = atomic_load_explicit(&handle->traffic.sent_bytes,
+		memory_order_relaxed);
+	const int64_t received_bytes = atomic_load_explicit(&handle->traffic.received_bytes,
+		memory_order_relaxed);
+	const int64_t drop_network = atomic_load_explicit(&handle->traffic.drop_network,
+		memory_order_relaxed);
+	const arena_t *arena = &handle->data.from_worker;
+	const size_t arena_used = atomic_load_explicit(&arena->head, memory_order_relaxed)
+		- atomic_load_explicit(&arena->tail, memory_order_relaxed);
+	const float fill_input = (float)arena_used / arena->size;
+	const arena_t *out = &handle->data.to_worker;
+	const size_t out_used = atomic_load_explicit(&out->head, memory_order_relaxed)
+		- atomic_load_explicit(&out->tail, memory_order_relaxed);
+	const float fill_output = (float)out_used / out->size;
+	const float switch_time = atomic_load_explicit(&handle->traffic.switch_time,
+		memory_order_relaxed) * 1e-3f; // ms
+
+	if(state->osc_sent_bytes != sent_bytes)
+	{
+		state->osc_sent_bytes = sent_bytes;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_sent_bytes, &handle->ref);
+	}
+
+	if(state->osc_received_bytes != received_bytes)
+	{
+		state->osc_received_bytes = received_bytes;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_received_bytes, &handle->ref);
+	}
+
+	if(state->osc_drop_input != (int64_t)handle->stats.drop_input)
+	{
+		state->osc_drop_input = handle->stats.drop_input;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_drop_input, &handle->ref);
+	}
+
+	if(state->osc_drop_output != (int64_t)handle->stats.drop_output)
+	{
+		state->osc_drop_output = handle->stats.drop_output;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_drop_output, &handle->ref);
+	}
+
+	if(state->osc_drop_network != drop_network)
+	{
+		state->osc_drop_network = drop_network;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_drop_network, &handle->ref);
+	}
+
+	if(state->osc_late != (int64_t)handle->stats.late)
+	{
+		state->osc_late = handle->stats.late;
+		memcpy(state->osc_late_histogram.bins, handle->stats.late_bins,
+			sizeof(state->osc_late_histogram.bins));
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_late, &handle->ref);
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_late_histogram, &handle->ref);
+	}
+
+	if(state->osc_queue_peak != (int32_t)handle->stats.queue_peak)
+	{
+		state->osc_queue_peak = handle->stats.queue_peak;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_queue_peak, &handle->ref);
+	}
+
+	if(state->osc_fill_input != fill_input)
+	{
+		state->osc_fill_input = fill_input;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_fill_input, &handle->ref);
+	}
+
+	if(state->osc_fill_output != fill_output)
+	{
+		state->osc_fill_output = fill_output;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_fill_output, &handle->ref);
+	}
+
+	if(state->osc_switch_time != switch_time)
+	{
+		state->osc_switch_time = switch_time;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_switch_time, &handle->ref);
+	}
+
+	// the most lagging of the remote clocks is shown
+	int latest = -1;
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		if(handle->clock.remotes[i].locked && ( (latest < 0)
+			|| (handle->clock.remotes[i].offset > handle->clock.remotes[latest].offset) ) )
+		{
+			latest = i;
+		}
+	}
+
+	if(latest >= 0)
+	{
+		const float offset = handle->clock.remotes[latest].offset * 1e3; // ms
+		const float jitter = handle->clock.remotes[latest].jitter * 1e3; // ms
+
+		if(state->osc_offset != offset)
+		{
+			state->osc_offset = offset;
+			props_set(&handle->props, forge, frames, handle->uris.eteroj_offset, &handle->ref);
+		}
+
+		if(state->osc_jitter != jitter)
+		{
+			state->osc_jitter = jitter;
+			props_set(&handle->props, forge, frames, handle->uris.eteroj_jitter, &handle->ref);
+		}
+	}
+}
+
+// rt
+static inline void
+_traffic_update(plughandle_t *handle, uint32_t frames)
+{
+	LV2_Atom_Forge *forge = &handle->forge;
+
+	const int32_t peers = atomic_load_explicit(&handle->traffic.peers,
+		memory_order_relaxed);
+	const int64_t sent = atomic_load_explicit(&handle->traffic.sent,
+		memory_order_relaxed);
+	const int64_t received = atomic_load_explicit(&handle->traffic.received,
+		memory_order_relaxed);
+
+	if(handle->state.osc_peers != peers)
+	{
+		handle->state.osc_peers = peers;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_peers, &handle->ref);
+	}
+
+	if(handle->state.osc_sent != sent)
+	{
+		handle->state.osc_sent = sent;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_sent, &handle->ref);
+	}
+
+	if(handle->state.osc_received != received)
+	{
+		handle->state.osc_received = received;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_received, &handle->ref);
+	}
+
+	if(handle->state.osc_wakeups != (int32_t)handle->wake.count)
+	{
+		handle->state.osc_wakeups = handle->wake.count;
+		props_set(&handle->props, forge, frames, handle->uris.eteroj_wakeups, &handle->ref);
+	}
+
+	handle->wake.count = 0;
+
+	if(handle->coalesce.packets)
+	{
+		const float packing = (float)handle->coalesce.messages / handle->coalesce.packets;
+
+		handle->coalesce.messages = 0;
+		handle->coalesce.packets = 0;
+
+		if(handle->state.osc_packing != packing)
+		{
+			handle->state.osc_packing = packing;
+			props_set(&handle->props, forge, frames, handle->uris.eteroj_packing, &handle->ref);
+		}
+	}
+}
+
+#if defined(__linux__)
+// rt and non-rt
+static inline void
+_io_wake(plughandle_t *handle)
+{
+	eventfd_write(handle->io.efd, 1);
+
+	// network thread blocks on a futex for shared memory streams
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(ep->rolling)
+		{
+			lv2_osc_stream_wake(ep->stream);
+		}
+	}
+}
+#endif
+
+static void
+run(LV2_Handle instance, uint32_t nsamples)
+{
+	plughandle_t *handle = instance;
+
+	LV2_Atom_Forge *forge = &handle->forge;
+	LV2_Atom_Forge_Frame frame;
+	uint32_t capacity;
+
+	// prepare sequence forges
+	capacity = handle->osc_out->atom.size;
+	lv2_atom_forge_set_buffer(forge, (uint8_t *)handle->osc_out, capacity);
+	handle->ref = lv2_atom_forge_sequence_head(forge, &frame, 0);
+
+	props_idle(&handle->props, &handle->forge, 0, &handle->ref);
+
+	// endpoints as assigned to URLs by worker
+	handle->data.targets = atomic_load_explicit(&handle->data.configured,
+		memory_order_acquire);
+	if(!handle->data.targets)
+	{
+		handle->data.targets = 1U << 0; // keep queueing for first endpoint
+	}
+
+	// leave arenas to worker while it resizes them
+	int resize = atomic_load_explicit(&handle->resize.state, memory_order_acquire);
+	if(resize == RESIZE_REQUEST)
+	{
+		resize = RESIZE_HOLD;
+		atomic_store_explicit(&handle->resize.state, resize, memory_order_release);
+	}
+	const bool hold = (resize == RESIZE_HOLD);
+
+	// write outgoing data, events deferred during a resize go first
+	bool queued = false;
+	if(!hold)
+	{
+		LV2_ATOM_SEQUENCE_FOREACH(&handle->defer.seq, ev)
+		{
+			if(_output(handle, 0, (const LV2_Atom_Object *)&ev->body))
+			{
+				queued = true;
+			}
+		}
+		lv2_atom_sequence_clear(&handle->defer.seq);
+	}
+
+	LV2_ATOM_SEQUENCE_FOREACH(handle->osc_in, ev)
+	{
+		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)&ev->body;
+
+		if(obj->atom.type == forge->Object)
+		{
+			if(  !props_advance(&handle->props, &handle->forge, ev->time.frames, obj, &handle->ref)
+				&& lv2_osc_is_message_or_bundle_type(&handle->osc_urid, obj->body.otype) )
+			{
+				if(hold)
+				{
+					if(!lv2_atom_sequence_append_event(&handle->defer.seq,
+						sizeof(handle->defer) - sizeof(LV2_Atom), ev))
+					{
+						handle->stats.drop_output += 1; // arenas being resized for too long
+					}
+					continue;
+				}
+
+				if(_output(handle, ev->time.frames, obj))
+				{
+					queued = true;
+				}
+			}
+		}
+	}
+
+	_coalesce_flush(handle);
+
+	// send held bundles due in this period
+	if(!hold && _release(handle, nsamples))
+	{
+		queued = true;
+	}
+
+#if defined(__linux__)
+	// wake network thread right away, streams stay put until we are done
+	if(queued)
+	{
+		atomic_fetch_add_explicit(&handle->io.wakers, 1, memory_order_seq_cst);
+
+		if(atomic_load_explicit(&handle->io.active, memory_order_seq_cst))
+		{
+			_io_wake(handle);
+		}
+
+		atomic_fetch_sub_explicit(&handle->io.wakers, 1, memory_order_release);
+	}
+#endif
+
+	// arenas pinned by records in use are compacted on worker
+	if(handle->rx.pinned || handle->tx.pinned)
+	{
+		atomic_store_explicit(&handle->resize.compact, true, memory_order_relaxed);
+		handle->rx.pinned = false;
+		handle->tx.pinned = false;
+	}
+
+	// wake worker upon demand only, it runs the streams unless threaded
+	bool wake = atomic_exchange_explicit(&handle->wake.pending, false, memory_order_acquire)
+		|| handle->wake.control
+		|| (resize != RESIZE_IDLE)
+		|| atomic_load_explicit(&handle->resize.compact, memory_order_relaxed);
+
+	if(!wake && !atomic_load_explicit(&handle->io.active, memory_order_acquire))
+	{
+		const arena_t *out = &handle->data.to_worker;
+
+		// readable sockets are flagged as pending by the network thread
+		wake = queued
+			|| (atomic_load_explicit(&out->head, memory_order_relaxed)
+				!= atomic_load_explicit(&out->tail, memory_order_acquire));
+	}
+
+	handle->wake.frames += nsamples;
+
+	if(wake || (handle->wake.frames >= handle->wake.interval) )
+	{
+		const int32_t dummy = 0;
+		handle->sched->schedule_work(handle->sched->handle, sizeof(int32_t), &dummy);
+
+		handle->wake.control = false;
+		handle->wake.frames = 0;
+		handle->wake.count += 1;
+	}
+
+	// bundles queued in earlier periods may map to -1 frames when rescheduled
+	const uint32_t seq = handle->rx.seq;
+
+	if(handle->osc_sched)
+	{
+		handle->clock.now = handle->osc_sched->frames2osc(handle->osc_sched->handle, 0.0);
+	}
+
+	// read incoming data
+	const list_t *l;
+	uint32_t off;
+	while(!hold && (l = _arena_read_request(&handle->data.from_worker, &off)))
+	{
+		_unroll(handle, l, off);
+	}
+
+	// the few bundles scheduled for long pin the tail of the ring, move them
+	// out of the way of the network thread, a bounded number per period
+	for(unsigned i = 0; !hold && (i < RELOCATE_MAX); i++)
+	{
+		if(  !_arena_crowded(&handle->data.from_worker)
+			|| !_queue_relocate(&handle->rx, &handle->data.from_worker) )
+		{
+			break;
+		}
+	}
+
+	_clock_update(handle, nsamples / handle->rate);
+
+	// handle scheduled bundles
+	while(!hold && handle->rx.nheap)
+	{
+		const sched_t *top = &handle->rx.heap[0];
+		l = _get_list(top->arena, top->off);
+
+		double frames = handle->osc_sched->osc2frames(handle->osc_sched->handle,
+			top->timetag);
+
+		if(frames < 0.0) // late event
+		{
+			if((int32_t)(top->seq - seq) >= 0)
+			{
+				_late(handle, -frames);
+			}
+
+			frames = 0.0; // dispatch as early as possible
+		}
+		else if(frames >= nsamples) // not scheduled for this period
+		{
+			break;
+		}
+
+		_parse(handle, frames, l);
+
+		_queue_pop(&handle->rx);
+	}
+
+	if(handle->status_updated)
+	{
+		props_set(&handle->props, forge, nsamples-1, handle->uris.eteroj_connected, &handle->ref);
+		props_set(&handle->props, forge, nsamples-1, handle->uris.eteroj_error, &handle->ref);
+
+		handle->status_updated = false;
+	}
+
+	handle->traffic.frames += nsamples;
+	if(handle->traffic.frames >= handle->traffic.period)
+	{
+		_traffic_update(handle, nsamples - 1);
+
+		if(!hold) // fill levels need arenas
+		{
+			_stats_update(handle, nsamples - 1);
+		}
+
+		handle->traffic.frames = 0;
+	}
+
+	if(handle->ref)
+	{
+		lv2_atom_forge_pop(forge, &frame);
+	}
+	else
+	{
+		lv2_atom_sequence_clear(handle->osc_out);
+	}
+}
+
+static inline void
+_handle_enum(plughandle_t *handle, LV2_OSC_Enum ev)
+{
+	const char *err = "";
+
+	if(ev & LV2_OSC_ERR)
+	{
+		char buf [STR_LEN] = { '\0' };
+		err = strerror_r(ev & LV2_OSC_ERR, buf, sizeof(buf));
+
+		if(!err)
+		{
+			err = "Unknown";
+		}
+
+		if(handle->log)
+		{
+			lv2_log_trace(&handle->logger, "%s\n", err);
+		}
+	}
+
+	if(strcmp(handle->state.osc_error, err))
+	{
+		strncpy(handle->state.osc_error, err, STR_LEN-1);
+
+		props_impl_t *impl = _props_impl_get(&handle->props, handle->uris.eteroj_error);
+		if(impl)
+		{
+			_props_impl_set(&handle->props, impl, handle->forge.String, strlen(err), err);
+		}
+
+		handle->status_updated = true;
+	}
+
+	const bool connected = (ev & LV2_OSC_CONN) == LV2_OSC_CONN;
+
+	if(handle->state.osc_connected != connected)
+	{
+#if 0
+		if(handle->log)
+			lv2_log_trace(&handle->logger, "connected: %i\n", connected);
+#endif
+
+		handle->state.osc_connected = connected;
+		handle->status_updated = true;
+	}
+}
+
+// non-rt, position in outgoing arena past the packets staged by the stream of
+// endpoint, which releases them itself once written
+static inline size_t
+_endpoint_unstaged(endpoint_t *ep)
+{
+	plughandle_t *handle = ep->handle;
+	arena_t *out = &handle->data.to_worker;
+	const uint32_t target = 1U << ep->idx;
+	size_t read = ep->read;
+
+	for(size_t i = ep->rolling ? lv2_osc_stream_staged(ep->stream) : 0; i; i--)
+	{
+		if(!_arena_peek(out, &read, target))
+		{
+			break;
+		}
+
+		_arena_next(out, &read);
+	}
+
+	return read;
+}
+
+// non-rt, drops packets queued for endpoint
+static inline void
+_endpoint_skip(endpoint_t *ep)
+{
+	plughandle_t *handle = ep->handle;
+	arena_t *out = &handle->data.to_worker;
+	const uint32_t target = 1U << ep->idx;
+
+	if(ep->rolling) // staged packets would pin the arena for all others
+	{
+		lv2_osc_stream_release(ep->stream);
+	}
+
+	size_t read = _endpoint_unstaged(ep);
+
+	while(_arena_peek(out, &read, target))
+	{
+		_arena_done(out, &read, target);
+		atomic_fetch_add_explicit(&handle->traffic.drop_network, 1, memory_order_relaxed);
+	}
+}
+
+// non-rt, drops oldest packets queued for an endpoint lagging behind by more
+// than half of the shared arena, which would otherwise fill up for all others
+static inline void
+_endpoint_trim(endpoint_t *ep)
+{
+	plughandle_t *handle = ep->handle;
+	arena_t *out = &handle->data.to_worker;
+	const uint32_t target = 1U << ep->idx;
+	const size_t head = atomic_load_explicit(&out->head, memory_order_acquire);
+
+	// packets staged by a stalled stream would pin the arena for all others
+	if(_arena_peek(out, &ep->read, target) && (head - ep->read > out->size/2))
+	{
+		lv2_osc_stream_release(ep->stream);
+	}
+
+	size_t read = _endpoint_unstaged(ep);
+
+	while(_arena_peek(out, &read, target) && (head - read > out->size/2))
+	{
+		_arena_done(out, &read, target);
+		atomic_fetch_add_explicit(&handle->traffic.drop_network, 1, memory_order_relaxed);
+	}
+}
+
+// non-rt
+static inline LV2_OSC_Enum
+_stream_run(plughandle_t *handle)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	unsigned nlive = 0;
+	unsigned peers = 0;
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		if(handle->data.endpoints[i].rolling)
+		{
+			nlive += 1;
+		}
+	}
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		// packets wait for a sole endpoint to get peers, but must not hold back
+		// other endpoints
+		if(!ep->rolling || ( (nlive > 1) && !lv2_osc_stream_get_peers(ep->stream) ) )
+		{
+			_endpoint_skip(ep);
+		}
+
+		if(!ep->rolling)
+		{
+			continue;
+		}
+
+		const LV2_OSC_Enum ev1 = lv2_osc_stream_run(ep->stream);
+
+		peers += lv2_osc_stream_get_peers(ep->stream);
+
+		// a slow endpoint must not hold back the others
+		if(nlive > 1)
+		{
+			_endpoint_trim(ep);
+		}
+
+		// packets dropped by stream, counted once per run
+		const int err = ev1 & LV2_OSC_ERR;
+		if( (err == EMSGSIZE) || (err == ENOBUFS) )
+		{
+			atomic_fetch_add_explicit(&handle->traffic.drop_network, 1, memory_order_relaxed);
+		}
+
+		// report first error only
+		ev |= (ev & LV2_OSC_ERR)
+			? ev1 & ~LV2_OSC_ERR
+			: ev1;
+	}
+
+	atomic_store_explicit(&handle->traffic.peers, peers, memory_order_relaxed);
+
+	return ev;
+}
+
+#if defined(__linux__)
+// non-rt, stream descriptors report once and are rearmed after each run
+static inline void
+_io_register(plughandle_t *handle, int fd, bool oneshot)
+{
+	struct epoll_event ev = {
+		.events = oneshot ? EPOLLIN | EPOLLONESHOT : EPOLLIN,
+		.data.fd = fd
+	};
+
+	if( (epoll_ctl(handle->io.epfd, EPOLL_CTL_MOD, fd, &ev) != 0)
+		&& (errno == ENOENT) )
+	{
+		epoll_ctl(handle->io.epfd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+// non-rt, by whoever runs the streams, after having drained them. File
+// descriptors change upon (re)connection, accepted clients and reinits, and
+// their numbers may be reused, so all of them are (re)armed every time,
+// closed ones are removed from epoll implicitly
+static inline void
+_io_watch(plughandle_t *handle)
+{
+	int fds [IO_FDS];
+	unsigned n = 0;
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(ep->rolling)
+		{
+			n += lv2_osc_stream_get_all_file_descriptors(ep->stream, &fds[n]);
+		}
+	}
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		_io_register(handle, fds[i], true);
+	}
+}
+
+// non-rt network thread
+static void *
+_io_thread(void *data)
+{
+	plughandle_t *handle = data;
+	const arena_t *out = &handle->data.to_worker;
+	int timeout = 0;
+
+	while(!atomic_load_explicit(&handle->io.done, memory_order_acquire))
+	{
+		struct epoll_event evs [IO_FDS + 1];
+		LV2_OSC_Stream *shm = NULL;
+		unsigned nlive = 0;
+		int nevs = 0;
+
+		for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+		{
+			endpoint_t *ep = &handle->data.endpoints[i];
+
+			if(ep->rolling)
+			{
+				nlive += 1;
+
+				if(ep->stream->shm)
+				{
+					shm = ep->stream;
+				}
+			}
+		}
+
+		if(shm && (nlive == 1)) // no file descriptors, block on futex of ring instead
+		{
+			lv2_osc_stream_wait(shm, timeout);
+		}
+		else // shared memory rings next to sockets are polled
+		{
+			nevs = epoll_wait(handle->io.epfd, evs, IO_FDS + 1,
+				shm ? IO_RETRY_MS : timeout);
+		}
+
+		for(int i = 0; i < nevs; i++)
+		{
+			if(evs[i].data.fd == handle->io.efd)
+			{
+				eventfd_t cnt;
+				eventfd_read(handle->io.efd, &cnt);
+			}
+		}
+
+		const LV2_OSC_Enum ev = _stream_run(handle);
+		const bool connected = (ev & LV2_OSC_CONN) == LV2_OSC_CONN;
+
+		atomic_fetch_or_explicit(&handle->io.ev, ev & ~LV2_OSC_CONN,
+			memory_order_release);
+
+		// have worker report errors and connection changes
+		if( (atomic_exchange_explicit(&handle->io.connected, connected,
+				memory_order_acq_rel) != connected)
+			|| (ev & LV2_OSC_ERR) )
+		{
+			atomic_store_explicit(&handle->wake.pending, true, memory_order_release);
+		}
+
+		_io_watch(handle);
+
+		// retry soon if socket send buffer was full
+		timeout = (atomic_load_explicit(&out->head, memory_order_acquire)
+				!= atomic_load_explicit(&out->tail, memory_order_relaxed))
+			? IO_RETRY_MS
+			: IO_TIMEOUT_MS;
+	}
+
+	return NULL;
+}
+
+// non-rt watcher thread for streams run by worker, flags readable sockets as
+// pending for rt to wake the worker, which rearms them once drained
+static void *
+_io_watcher(void *data)
+{
+	plughandle_t *handle = data;
+
+	while(!atomic_load_explicit(&handle->io.done, memory_order_acquire))
+	{
+		struct epoll_event evs [IO_FDS + 1];
+		bool ready = false;
+
+		const int nevs = epoll_wait(handle->io.epfd, evs, IO_FDS + 1,
+			IO_TIMEOUT_MS);
+
+		for(int i = 0; i < nevs; i++)
+		{
+			if(evs[i].data.fd == handle->io.efd)
+			{
+				eventfd_t cnt;
+				eventfd_read(handle->io.efd, &cnt);
 			}
-			else if(handle->log)
+			else
+			{
+				ready = true;
+			}
+		}
+
+		if(ready)
+		{
+			atomic_store_explicit(&handle->wake.pending, true, memory_order_release);
+		}
+	}
+
+	return NULL;
+}
+#endif
+
+// non-rt, starts network thread, which runs the streams if threaded or else
+// watches them for the worker
+static inline bool
+_io_start(plughandle_t *handle)
+{
+#if defined(__linux__)
+	if(handle->io.running)
+	{
+		return true;
+	}
+
+	if( (handle->io.efd < 0) || (handle->io.epfd < 0) )
+	{
+		return false;
+	}
+
+	_io_register(handle, handle->io.efd, false);
+
+	atomic_store_explicit(&handle->io.ev, LV2_OSC_NONE, memory_order_relaxed);
+	atomic_store_explicit(&handle->io.done, false, memory_order_release);
+
+	if(pthread_create(&handle->io.thread, NULL,
+		handle->io.threaded ? _io_thread : _io_watcher, handle) != 0)
+	{
+		return false;
+	}
+
+	handle->io.running = true;
+	atomic_store_explicit(&handle->io.active, handle->io.threaded,
+		memory_order_release);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+// non-rt
+static inline void
+_io_stop(plughandle_t *handle)
+{
+#if defined(__linux__)
+	if(handle->io.running)
+	{
+		atomic_store_explicit(&handle->io.active, false, memory_order_seq_cst);
+		atomic_store_explicit(&handle->io.done, true, memory_order_release);
+		_io_wake(handle);
+
+		// rt may still be waking streams about to be torn down
+		while(atomic_load_explicit(&handle->io.wakers, memory_order_seq_cst))
+		{
+			sched_yield();
+		}
+
+		pthread_join(handle->io.thread, NULL);
+
+		// leave no pending wakeup behind for the next thread
+		eventfd_t cnt;
+		eventfd_read(handle->io.efd, &cnt);
+
+		handle->io.running = false;
+	}
+#endif
+}
+
+// non-rt, most instances need a single stream only
+static inline LV2_OSC_Stream *
+_endpoint_slot(endpoint_t *ep, unsigned i)
+{
+	if(!ep->slots[i])
+	{
+		ep->slots[i] = calloc(1, sizeof(LV2_OSC_Stream));
+
+		if(ep->slots[i])
+		{
+			mlock(ep->slots[i], sizeof(LV2_OSC_Stream));
+		}
+	}
+
+	return ep->slots[i];
+}
+
+static inline LV2_OSC_Enum
+_activate(plughandle_t *handle)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	handle->rolling = false;
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(!ep->rolling && ep->url)
+		{
+			if(!ep->stream && !(ep->stream = _endpoint_slot(ep, 0)) )
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
+				continue;
+			}
+
+			const LV2_OSC_Enum ev1 = lv2_osc_stream_init(ep->stream,
+				ep->url, &handle->data.driver, ep);
+
+			if( (ev1 & LV2_OSC_ERR) == LV2_OSC_NONE)
 			{
-				lv2_log_trace(&handle->logger, "message pool overflow");
+				// network thread is restarted with new endpoint by caller
+				_io_stop(handle);
+				ep->rolling = true;
 			}
+
+			ev |= ev1;
 		}
-		else if(handle->log)
+
+		if(ep->rolling)
 		{
-			lv2_log_trace(&handle->logger, "message too long");
+			handle->rolling = true;
 		}
 	}
-	else if(lv2_osc_reader_is_message(&reader)) // immediate dispatch
-	{
-		_parse(handle, 0.0, buf, size);
-	}
+
+	return ev;
 }
 
 static void
-run(LV2_Handle instance, uint32_t nsamples)
+activate(LV2_Handle instance)
 {
 	plughandle_t *handle = instance;
 
-	LV2_Atom_Forge *forge = &handle->forge;
-	LV2_Atom_Forge_Frame frame;
-	uint32_t capacity;
-
-	// prepare sequence forges
-	capacity = handle->osc_out->atom.size;
-	lv2_atom_forge_set_buffer(forge, (uint8_t *)handle->osc_out, capacity);
-	handle->ref = lv2_atom_forge_sequence_head(forge, &frame, 0);
+	_activate(handle);
+	atomic_store_explicit(&handle->wake.pending, true, memory_order_release);
+}
 
-	props_idle(&handle->props, &handle->forge, 0, &handle->ref);
+// non-rt, network thread must have been stopped
+static inline void
+_endpoint_deactivate(endpoint_t *ep)
+{
+	if(ep->next)
+	{
+		lv2_osc_stream_deinit(ep->next);
+		ep->next = NULL;
+	}
 
-	// write outgoing data
-	LV2_ATOM_SEQUENCE_FOREACH(handle->osc_in, ev)
+	if(ep->rolling)
 	{
-		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)&ev->body;
+		lv2_osc_stream_deinit(ep->stream);
+		ep->rolling = false;
+	}
+}
 
-		if(obj->atom.type == forge->Object)
-		{
-			if(  !props_advance(&handle->props, &handle->forge, ev->time.frames, obj, &handle->ref)
-				&& lv2_osc_is_message_or_bundle_type(&handle->osc_urid, obj->body.otype) )
-			{
-				uint8_t *dst;
-				size_t reserve = obj->atom.size;
-				if((dst = varchunk_write_request(handle->data.to_worker, reserve)))
-				{
-					LV2_OSC_Writer writer;
-					lv2_osc_writer_initialize(&writer, dst, reserve);
-					lv2_osc_writer_packet(&writer, &handle->osc_urid, handle->unmap, obj->atom.size, &obj->body);
-					size_t written;
-					lv2_osc_writer_finalize(&writer, &written);
+static inline void
+_deactivate(plughandle_t *handle)
+{
+	_io_stop(handle);
 
-					if(written)
-					{
-						varchunk_write_advance(handle->data.to_worker, written);
-					}
-				}
-				else if(handle->log)
-				{
-					lv2_log_trace(&handle->logger, "output ringbuffer overflow");
-				}
-			}
-		}
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		_endpoint_deactivate(&handle->data.endpoints[i]);
 	}
 
-	// wake worker once per period
-	const int32_t dummy = 0;
-	handle->sched->schedule_work(handle->sched->handle, sizeof(int32_t), &dummy);
+	handle->rolling = false;
 
-	// reschedule scheduled bundles
-	if(handle->osc_sched)
+	atomic_store_explicit(&handle->traffic.peers, 0, memory_order_relaxed);
+}
+
+static void
+deactivate(LV2_Handle instance)
+{
+	plughandle_t *handle = instance;
+
+	_deactivate(handle);
+}
+
+// non-rt
+static inline double
+_monotonic(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// non-rt, set up stream for new URL next to the current one
+static inline LV2_OSC_Enum
+_prepare(endpoint_t *ep)
+{
+	plughandle_t *handle = ep->handle;
+	LV2_OSC_Stream *next = _endpoint_slot(ep, (ep->stream == ep->slots[0]) ? 1 : 0);
+
+	if(!next)
 	{
-		for(list_t *l = handle->list; l->size; l++)
-		{
-			uint64_t time = be64toh(*(uint64_t *)(l->buf + 8));
+		return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, ENOMEM);
+	}
 
-			double frames = handle->osc_sched->osc2frames(handle->osc_sched->handle, time);
-			if(frames < 0.0) // we may occasionally get -1 frames events when rescheduling
-			{
-				l->frames = 0.0;
-			}
-			else
-			{
-				l->frames = frames;
-			}
-		}
+	// superseded by yet another URL change
+	if(ep->next)
+	{
+		lv2_osc_stream_deinit(ep->next);
+		ep->next = NULL;
 	}
 
-	const unsigned nlist = handle->nlist;
+	ep->since = _monotonic();
 
-	// read incoming data
-	const uint8_t *ptr;
-	size_t size;
-	while((ptr = varchunk_read_request(handle->data.from_worker, &size)))
+	const LV2_OSC_Enum ev = lv2_osc_stream_init(next, ep->url,
+		&handle->data.prepare, ep);
+
+	if(ev & LV2_OSC_ERR)
 	{
-		_unroll(handle, ptr, size);
+		// keep current stream running
+		lv2_osc_stream_deinit(next);
 
-		varchunk_read_advance(handle->data.from_worker);
+		return ev;
 	}
 
-	const unsigned added = handle->nlist - nlist;
+	ep->next = next;
+
+	return ev;
+}
+
+// non-rt, switch to prepared stream once it can take over
+static inline LV2_OSC_Enum
+_switch(endpoint_t *ep)
+{
+	plughandle_t *handle = ep->handle;
+	LV2_OSC_Stream *next = ep->next;
 
-	if(added)
+	const LV2_OSC_Enum ev = lv2_osc_stream_run(next);
+	const double elapsed = _monotonic() - ep->since;
+
+	// servers and resolved datagram clients can take over right away,
+	// connection based clients once connected
+	const bool ready = next->server
+		|| (ev & LV2_OSC_CONN)
+		|| ( (next->sock >= 0) && (next->socket_type == SOCK_DGRAM) );
+
+	if(!ready && (elapsed < SWITCH_TIMEOUT) )
 	{
-		_sort_list(handle);
+		return ev & LV2_OSC_ERR;
 	}
 
-	unsigned deleted = 0;
+	// network thread is restarted on new stream by caller
+	_io_stop(handle);
 
-	// handle scheduled bundles
-	for(list_t *l = handle->list; l->size; l++)
+	LV2_OSC_Stream *prev = ep->stream;
+
+	// packets still queued in arena carry over to new stream
+	next->driv = &handle->data.driver;
+	ep->stream = next;
+	ep->next = NULL;
+
+	lv2_osc_stream_deinit(prev);
+
+	atomic_store_explicit(&handle->traffic.switch_time, elapsed*1e6,
+		memory_order_relaxed);
+
+	return ev & LV2_OSC_ERR;
+}
+
+// non-rt, (re)configure endpoints from whitespace separated URL list, URLs
+// still listed keep their endpoint and thus subject, new ones take over the
+// endpoints of removed or unused ones in order
+static inline LV2_OSC_Enum
+_endpoints_update(plughandle_t *handle, char *urls)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	char *saveptr = NULL;
+	char *fresh [MAX_ENDPOINTS];
+	unsigned nfresh = 0;
+	unsigned nurls = 0;
+	uint32_t kept = 0;
+
+	for(char *url = strtok_r(urls, " \t\r\n", &saveptr);
+		url;
+		url = strtok_r(NULL, " \t\r\n", &saveptr))
 	{
-		if(l->frames < 0.0) // late event
+		if(nurls++ == MAX_ENDPOINTS)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, E2BIG); // more URLs than endpoints
+			break;
+		}
+
+		unsigned i;
+		for(i = 0; i < MAX_ENDPOINTS; i++)
 		{
-			if(handle->log)
+			const endpoint_t *ep = &handle->data.endpoints[i];
+
+			if( !(kept & (1U << i)) && ep->url && !strcmp(ep->url, url) )
 			{
-				lv2_log_trace(&handle->logger, "late event: %lf samples", l->frames);
+				kept |= 1U << i; // unchanged, keeps running
+				break;
 			}
+		}
 
-			l->frames = 0.0; // dispatch as early as possible
+		if(i == MAX_ENDPOINTS)
+		{
+			fresh[nfresh++] = url;
 		}
-		else if(l->frames >= nsamples) // not scheduled for this period
+	}
+
+	for(unsigned i = 0, j = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(kept & (1U << i))
 		{
-			break;
+			continue;
 		}
 
-		_parse(handle, l->frames, l->buf, l->size);
+		const char *url = (j < nfresh) ? fresh[j++] : NULL;
 
-		_invalidate_list(l);
-		deleted++;
-	}
+		if(!url && !ep->url)
+		{
+			continue;
+		}
 
-	if(deleted)
-	{
-		_sort_list(handle);
-		handle->nlist -= deleted;
-	}
+		if(ep->url)
+		{
+			free(ep->url);
+		}
+		ep->url = url ? strdup(url) : NULL;
 
-	if(handle->status_updated)
-	{
-		props_set(&handle->props, forge, nsamples-1, handle->uris.eteroj_connected, &handle->ref);
-		props_set(&handle->props, forge, nsamples-1, handle->uris.eteroj_error, &handle->ref);
+		if(ep->rolling && !ep->url) // removed from list
+		{
+			_io_stop(handle);
+			_endpoint_deactivate(ep);
+		}
+		else if(ep->rolling)
+		{
+			// current stream keeps running until new one is ready
+			const LV2_OSC_Enum prep = _prepare(ep);
 
-		handle->status_updated = false;
+			if( (prep & LV2_OSC_ERR) == EADDRINUSE)
+			{
+				// address still bound by current stream, tear it down first
+				_io_stop(handle);
+				_endpoint_deactivate(ep);
+			}
+			else
+			{
+				ev |= prep;
+			}
+		}
 	}
 
-	if(handle->ref)
-	{
-		lv2_atom_forge_pop(forge, &frame);
-	}
-	else
+	uint32_t configured = 0;
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
 	{
-		lv2_atom_sequence_clear(handle->osc_out);
+		if(handle->data.endpoints[i].url)
+		{
+			configured |= 1U << i;
+		}
 	}
+	atomic_store_explicit(&handle->data.configured, configured, memory_order_release);
+
+	return ev;
 }
 
-static inline void
-_handle_enum(plughandle_t *handle, LV2_OSC_Enum ev)
+// non-rt, rt holds off arenas meanwhile
+static inline LV2_OSC_Enum
+_resize(plughandle_t *handle)
 {
-	const char *err = "";
-
-	if(ev & LV2_OSC_ERR)
+	arena_t *arenas [4] = {
+		&handle->rx.arena,
+		&handle->tx.arena,
+		&handle->data.to_worker,
+		&handle->data.from_worker
+	};
+	queue_t *queues [2] = {
+		&handle->rx,
+		&handle->tx
+	};
+	const size_t size = handle->resize.arena;
+	const unsigned nheap = handle->resize.queue;
+	uint8_t *bufs [4] = { NULL };
+	sched_t *heaps [2] = { NULL };
+
+	_io_stop(handle); // network thread is producer and consumer, too
+
+	// whatever is queued right now must fit
+	for(unsigned i = 0; i < 4; i++)
 	{
-		char buf [STR_LEN] = { '\0' };
-		err = strerror_r(ev & LV2_OSC_ERR, buf, sizeof(buf));
-
-		if(!err)
+		if(_arena_used(arenas[i]) > size)
 		{
-			err = "Unknown";
+			return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, ENOBUFS);
 		}
+	}
 
-		if(handle->log)
+	for(unsigned i = 0; i < 2; i++)
+	{
+		if(queues[i]->nheap > nheap)
 		{
-			lv2_log_trace(&handle->logger, "%s\n", err);
+			return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, ENOBUFS);
 		}
 	}
 
-	if(strcmp(handle->state.osc_error, err))
-	{
-		strncpy(handle->state.osc_error, err, STR_LEN-1);
+	bool failed = false;
 
-		props_impl_t *impl = _props_impl_get(&handle->props, handle->uris.eteroj_error);
-		if(impl)
+	for(unsigned i = 0; i < 4; i++)
+	{
+		if(!(bufs[i] = malloc(size)))
 		{
-			_props_impl_set(&handle->props, impl, handle->forge.String, strlen(err), err);
+			failed = true;
 		}
-
-		handle->status_updated = true;
 	}
 
-	const bool connected = (ev & LV2_OSC_CONN) == LV2_OSC_CONN;
-
-	if(handle->state.osc_connected != connected)
+	for(unsigned i = 0; i < 2; i++)
 	{
-#if 0
-		if(handle->log)
-			lv2_log_trace(&handle->logger, "connected: %i\n", connected);
-#endif
-
-		handle->state.osc_connected = connected;
-		handle->status_updated = true;
+		if(!(heaps[i] = malloc(nheap * sizeof(sched_t))))
+		{
+			failed = true;
+		}
 	}
-}
 
-static inline LV2_OSC_Enum
-_activate(plughandle_t *handle)
-{
-	if(!handle->rolling && handle->osc_url)
+	if(failed)
 	{
-		const LV2_OSC_Enum ev = lv2_osc_stream_init(&handle->data.stream,
-			handle->osc_url, &handle->data.driver, handle);
+		for(unsigned i = 0; i < 4; i++)
+		{
+			free(bufs[i]);
+		}
 
-		if( (ev & LV2_OSC_ERR) == LV2_OSC_NONE)
+		for(unsigned i = 0; i < 2; i++)
 		{
-			handle->rolling = true;
+			free(heaps[i]);
 		}
 
-		return ev;
+		return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, ENOMEM);
 	}
 
-	return LV2_OSC_NONE;
-}
+	for(unsigned i = 0; i < 4; i++)
+	{
+		mlock(bufs[i], size);
+	}
 
-static void
-activate(LV2_Handle instance)
-{
-	plughandle_t *handle = instance;
+	for(unsigned i = 0; i < 2; i++)
+	{
+		queue_t *queue = queues[i];
 
-	_activate(handle);
-}
+		mlock(heaps[i], nheap * sizeof(sched_t));
+		memcpy(heaps[i], queue->heap, queue->nheap * sizeof(sched_t));
+		munlock(queue->heap, queue->size * sizeof(sched_t));
+		free(queue->heap);
 
-static inline void
-_deactivate(plughandle_t *handle)
-{
-	if(handle->rolling)
-	{
-		lv2_osc_stream_deinit(&handle->data.stream);
-		handle->rolling = false;
+		queue->heap = heaps[i];
+		queue->size = nheap;
+		_arena_move(&queue->arena, bufs[i], size, queue->heap);
 	}
-}
 
-static void
-deactivate(LV2_Handle instance)
-{
-	plughandle_t *handle = instance;
+	_arena_move(&handle->data.to_worker, bufs[2], size, NULL);
+	_arena_move(&handle->data.from_worker, bufs[3], size, handle->rx.heap);
 
-	_deactivate(handle);
+	// endpoints skip records not targeted at them, restart from tail
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		handle->data.endpoints[i].read = 0;
+	}
+
+	return LV2_OSC_NONE;
 }
 
 static void
@@ -657,13 +3199,41 @@ cleanup(LV2_Handle instance)
 {
 	plughandle_t *handle = instance;
 
-	varchunk_free(handle->data.from_worker);
-	varchunk_free(handle->data.to_worker);
+	_io_stop(handle);
+
 	varchunk_free(handle->data.to_thread);
+	_arena_deinit(&handle->data.to_worker);
+	_arena_deinit(&handle->data.from_worker);
 
-	if(handle->osc_url)
+	if(handle->io.efd >= 0)
 	{
-		free(handle->osc_url);
+		close(handle->io.efd);
+	}
+	if(handle->io.epfd >= 0)
+	{
+		close(handle->io.epfd);
+	}
+
+	_queue_deinit(&handle->rx);
+	_queue_deinit(&handle->tx);
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(ep->url)
+		{
+			free(ep->url);
+		}
+
+		for(unsigned j = 0; j < 2; j++)
+		{
+			if(ep->slots[j])
+			{
+				munlock(ep->slots[j], sizeof(LV2_OSC_Stream));
+				free(ep->slots[j]);
+			}
+		}
 	}
 
 	munlock(handle, sizeof(plughandle_t));
@@ -680,6 +3250,8 @@ _work(LV2_Handle instance,
 {
 	plughandle_t *handle = instance;
 	char *osc_url = NULL;
+	bool threaded = handle->io.threaded;
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
 
 	size_t size;
 	const uint8_t *body;
@@ -698,26 +3270,102 @@ _work(LV2_Handle instance,
 			}
 			osc_url = strdup(arg.s);
 		}
+		else if(!strcmp(arg.path, "/eteroj/threaded"))
+		{
+			threaded = arg.i != 0;
+		}
+		else if(!strcmp(arg.path, "/eteroj/resize"))
+		{
+			handle->resize.arena = _arena_size(handle, arg.i);
+			lv2_osc_reader_arg_next(&reader, &arg);
+			handle->resize.queue = _queue_size(arg.i);
+		}
 
 		varchunk_read_advance(handle->data.to_thread);
 	}
 
 	if(osc_url)
 	{
-		if(handle->osc_url)
+		ev |= _endpoints_update(handle, osc_url);
+		free(osc_url);
+	}
+
+	if(threaded != handle->io.threaded)
+	{
+		_io_stop(handle);
+		handle->io.threaded = threaded;
+	}
+
+	// rt has seen the request and left the arenas alone since
+	if(atomic_load_explicit(&handle->resize.state, memory_order_acquire) == RESIZE_HOLD)
+	{
+		const LV2_OSC_Enum err = _resize(handle);
+
+		if(err & LV2_OSC_ERR) // keep current sizes until changed again
 		{
-			free(handle->osc_url);
+			handle->resize.arena = handle->rx.arena.size;
+			handle->resize.queue = handle->rx.size;
 		}
-		handle->osc_url = osc_url;
 
-		_deactivate(handle);
+		ev |= err;
+		atomic_store_explicit(&handle->resize.state, RESIZE_IDLE, memory_order_release);
+	}
+
+	// resizing to the current sizes compacts arenas, too
+	if( ( (handle->resize.arena != handle->rx.arena.size)
+			|| (handle->resize.queue != handle->rx.size)
+			|| atomic_load_explicit(&handle->resize.compact, memory_order_relaxed) )
+		&& (atomic_load_explicit(&handle->resize.state, memory_order_relaxed) == RESIZE_IDLE) )
+	{
+		atomic_store_explicit(&handle->resize.compact, false, memory_order_relaxed);
+		atomic_store_explicit(&handle->resize.state, RESIZE_REQUEST, memory_order_release);
 	}
 
-	LV2_OSC_Enum ev = _activate(handle);
+	ev |= _activate(handle);
+
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if(ep->next)
+		{
+			ev |= _switch(ep);
+		}
+	}
 
 	if(handle->rolling)
 	{
-		ev |= lv2_osc_stream_run(&handle->data.stream);
+		if(_io_start(handle) && handle->io.threaded)
+		{
+			// network thread owns the stream, just collect its events
+			ev |= atomic_exchange_explicit(&handle->io.ev, LV2_OSC_NONE,
+				memory_order_acquire);
+
+			if(atomic_load_explicit(&handle->io.connected, memory_order_acquire))
+			{
+				ev |= LV2_OSC_CONN;
+			}
+		}
+		else
+		{
+			ev |= _stream_run(handle);
+#if defined(__linux__)
+			_io_watch(handle); // watcher flags readiness for rt to wake us
+#endif
+		}
+	}
+
+	// switching streams and shared memory rings without file descriptors need
+	// a run each period
+	for(unsigned i = 0; i < MAX_ENDPOINTS; i++)
+	{
+		endpoint_t *ep = &handle->data.endpoints[i];
+
+		if( ep->next || (ep->rolling && ep->stream->shm
+			&& !atomic_load_explicit(&handle->io.active, memory_order_relaxed)) )
+		{
+			atomic_store_explicit(&handle->wake.pending, true, memory_order_release);
+		}
 	}
 
 	respond(target, sizeof(LV2_OSC_Enum), &ev);
@@ -29,6 +29,7 @@
 
 #define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
 #define BUF_SIZE 8192
+#define RING_SEQUENCES 4 // input/output sequences in flight to/from worker
 
 #define MAX_NPROPS 1
 
@@ -75,7 +76,8 @@ struct _plughandle_t {
 	plugstate_t state;
 	plugstate_t stash;
 
-	uint8_t buf [BUF_SIZE];
+	size_t buf_size; // fits whole rings, e.g. any atom of the host's sequences
+	uint8_t *buf;
 };
 		
 static const char *base_path = "/ninja";
@@ -188,14 +190,27 @@ instantiate(const LV2_Descriptor* descriptor, double rate,
 		return NULL;
 	}
 
-	handle->to_worker = varchunk_new(BUF_SIZE, true);
-	handle->from_worker = varchunk_new(BUF_SIZE, true);
+	// rings carry whole sequences, size them after the host's buffers
+	const size_t ring_size = eteroj_ring_size(features, handle->map,
+		RING_SEQUENCES, BUF_SIZE);
+
+	handle->to_worker = varchunk_new(ring_size, true);
+	handle->from_worker = varchunk_new(ring_size, true);
+	handle->buf_size = ring_size;
+	handle->buf = malloc(handle->buf_size);
 
-	if(!handle->to_worker || !handle->from_worker)
+	if(!handle->to_worker || !handle->from_worker || !handle->buf)
 	{
+		if(handle->to_worker)
+			varchunk_free(handle->to_worker);
+		if(handle->from_worker)
+			varchunk_free(handle->from_worker);
+		free(handle->buf);
+		netatom_free(handle->netatom);
 		free(handle);
 		return NULL;
 	}
+	mlock(handle->buf, handle->buf_size);
 
 	handle->ser.size = 2018;
 	handle->ser.offset = 0;
@@ -235,6 +250,13 @@ _unroll(const char *path, const LV2_Atom_Tuple *arguments, void *data)
 	if(itr->type != forge->Chunk)
 		return;
 
+	if(itr->size > handle->buf_size)
+	{
+		if(handle->log)
+			lv2_log_trace(&handle->logger, "%s: chunk too large\n", __func__);
+		return;
+	}
+
 	memcpy(handle->buf, LV2_ATOM_BODY(itr), itr->size);
 
 	const LV2_Atom *atom = netatom_deserialize(handle->netatom,
@@ -273,10 +295,17 @@ _convert_seq(plughandle_t *handle, LV2_Atom_Forge *forge, const LV2_Atom_Sequenc
 		}
 		else
 		{
-			memcpy(handle->buf, atom, lv2_atom_total_size(atom)); //FIXME check < BUF_SIZE
+			if(lv2_atom_total_size(atom) > handle->buf_size)
+			{
+				if(handle->log)
+					lv2_log_trace(&handle->logger, "%s: atom too large\n", __func__);
+				continue;
+			}
+
+			memcpy(handle->buf, atom, lv2_atom_total_size(atom));
 
 			size_t sz;
-			const uint8_t *buf = netatom_serialize(handle->netatom, (LV2_Atom *)handle->buf, BUF_SIZE, &sz);
+			const uint8_t *buf = netatom_serialize(handle->netatom, (LV2_Atom *)handle->buf, handle->buf_size, &sz);
 			if(buf)
 			{
 				if(*ref)
@@ -372,6 +401,11 @@ cleanup(LV2_Handle instance)
 		varchunk_free(handle->to_worker);
 	if(handle->from_worker)
 		varchunk_free(handle->from_worker);
+	if(handle->buf)
+	{
+		munlock(handle->buf, handle->buf_size);
+		free(handle->buf);
+	}
 	netatom_free(handle->netatom);
 	munlock(handle, sizeof(plughandle_t));
 	free(handle);
@@ -27,6 +27,8 @@
 
 #define MAX_NPROPS 1
 #define MAX_TOKENS 256
+#define RING_SIZE 0x10000 // 64K, unless the host announces its sequence size
+#define RING_SEQUENCES 8 // input sequences worth of pending requests
 
 typedef struct _plugstate_t plugstate_t;
 typedef struct _plughandle_t plughandle_t;
@@ -488,7 +490,8 @@ instantiate(const LV2_Descriptor* descriptor, double rate,
 
 	handle->cnt = 0;
 
-	handle->rb = varchunk_new(65536, false);
+	handle->rb = varchunk_new(eteroj_ring_size(features, handle->map,
+		RING_SEQUENCES, RING_SIZE), false);
 
 	if(!props_init(&handle->props, descriptor->URI,
 		defs, MAX_NPROPS, &handle->state, &handle->stash,
@@ -19,11 +19,17 @@
 #define LV2_OSC_STREAM_H
 
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #if !defined(_WIN32)
 #	include <arpa/inet.h>
 #	include <sys/socket.h>
+#	include <sys/ioctl.h>
+#	include <sys/un.h>
+#	include <sys/uio.h>
+#	include <sys/stat.h>
 #	include <net/if.h>
 #	include <netinet/tcp.h>
 #	include <netinet/in.h>
@@ -31,11 +37,29 @@
 #	include <termios.h>
 #	include <limits.h>
 #endif
+#include <time.h>
+#if defined(__linux__) && defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		include <linux/io_uring.h>
+#		include <sys/mman.h>
+#		include <sys/syscall.h>
+#	endif
+#endif
+#if defined(LV2_OSC_STREAM_SHM) && LV2_OSC_STREAM_SHM
+#	include <varchunk.h>
+#	include <linux/futex.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <sys/syscall.h>
+#	include <signal.h>
+#	include <sched.h>
+#endif
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
 #include <poll.h>
+#include <pthread.h>
 
 #include <osc.lv2/osc.h>
 
@@ -51,6 +75,162 @@
 #	define LV2_OSC_STREAM_REQBUF 1024
 #endif
 
+// number of UDP datagrams per sendmmsg/recvmmsg call, 0 disables batching
+#if !defined(LV2_OSC_STREAM_MMSG)
+#	if defined(__linux__)
+#		define LV2_OSC_STREAM_MMSG 16
+#	else
+#		define LV2_OSC_STREAM_MMSG 0
+#	endif
+#endif
+
+// size of per-datagram batch receive buffers, larger ones spill into a shared one
+#if !defined(LV2_OSC_STREAM_MMSG_SIZE)
+#	define LV2_OSC_STREAM_MMSG_SIZE 0x2400 // 9K, jumbo frame
+#endif
+
+#define LV2_OSC_STREAM_MMSG_SPILL 0x10000 // 64K, largest UDP datagram
+
+// maximal number of simultaneous peers of an UDP server
+#if !defined(LV2_OSC_STREAM_PEERS)
+#	define LV2_OSC_STREAM_PEERS 8
+#endif
+
+// seconds after which a silent UDP peer is dropped, 0 disables expiry
+#if !defined(LV2_OSC_STREAM_PEER_TIMEOUT)
+#	define LV2_OSC_STREAM_PEER_TIMEOUT 30
+#endif
+
+#if LV2_OSC_STREAM_MMSG && (LV2_OSC_STREAM_PEERS > LV2_OSC_STREAM_MMSG)
+#	error "LV2_OSC_STREAM_PEERS must not exceed LV2_OSC_STREAM_MMSG"
+#endif
+
+#define LV2_OSC_STREAM_PEER_ALL -1
+
+// maximal number of simultaneous clients of a TCP server
+#if !defined(LV2_OSC_STREAM_CLIENTS)
+#	define LV2_OSC_STREAM_CLIENTS 8
+#endif
+
+#if LV2_OSC_STREAM_CLIENTS > 32
+#	error "LV2_OSC_STREAM_CLIENTS must not exceed 32"
+#endif
+
+// ms after which a TCP client blocking a batch others got already is dropped
+#if !defined(LV2_OSC_STREAM_STALL_TIMEOUT)
+#	define LV2_OSC_STREAM_STALL_TIMEOUT 1000
+#endif
+
+// arbitrary serial line speeds via termios2, needs the generic Linux termios
+// layout, otherwise only speeds with a Bxxx constant are supported
+#if !defined(LV2_OSC_STREAM_TERMIOS2)
+#	if defined(__linux__) && defined(TCGETS2) && ( defined(__x86_64__) \
+		|| defined(__i386__) || defined(__aarch64__) || defined(__arm__) \
+		|| defined(__riscv) )
+#		define LV2_OSC_STREAM_TERMIOS2 1
+#	else
+#		define LV2_OSC_STREAM_TERMIOS2 0
+#	endif
+#endif
+
+// maximal size of received TCP and serial frames, frames exceeding the fixed
+// receive buffer are assembled on the heap, larger ones are skipped, as are
+// ones exceeding the driver's write_max, which caps assembly per connection
+#if !defined(LV2_OSC_STREAM_FRAME_MAX)
+#	define LV2_OSC_STREAM_FRAME_MAX 0x1000000 // 16M
+#endif
+
+// io_uring backend for UDP streams, 0 disables it, 1 enables it for URLs
+// with the 'uring' option, 2 enables it for all UDP streams
+#if !defined(LV2_OSC_STREAM_URING)
+#	if defined(IORING_RECV_MULTISHOT) // multishot recvmsg needs Linux >= 6.0
+#		define LV2_OSC_STREAM_URING 1
+#	else
+#		define LV2_OSC_STREAM_URING 0
+#	endif
+#endif
+
+// number of submission queue entries, e.g. maximal linked sends per cycle
+#if !defined(LV2_OSC_STREAM_URING_DEPTH)
+#	define LV2_OSC_STREAM_URING_DEPTH 64
+#endif
+
+// number of provided receive buffers, must be a power of 2
+#if !defined(LV2_OSC_STREAM_URING_BUFS)
+#	define LV2_OSC_STREAM_URING_BUFS 32
+#endif
+
+// size of provided receive buffers, includes header and sender address,
+// larger datagrams are truncated and dropped
+#if !defined(LV2_OSC_STREAM_URING_BUF_SIZE)
+#	define LV2_OSC_STREAM_URING_BUF_SIZE 0x10040 // 64K, largest UDP datagram
+#endif
+
+#if LV2_OSC_STREAM_URING && (LV2_OSC_STREAM_PEERS >= LV2_OSC_STREAM_URING_DEPTH)
+#	error "LV2_OSC_STREAM_PEERS must be smaller than LV2_OSC_STREAM_URING_DEPTH"
+#endif
+
+#if LV2_OSC_STREAM_URING && (LV2_OSC_STREAM_URING_DEPTH > 64)
+#	error "LV2_OSC_STREAM_URING_DEPTH must not exceed 64"
+#endif
+
+// seconds a host name resolved in background is reused for reconnects
+#if !defined(LV2_OSC_STREAM_RESOLVE_TTL)
+#	define LV2_OSC_STREAM_RESOLVE_TTL 60
+#endif
+
+// initial and maximal delay in ms between attempts of a failing client
+#if !defined(LV2_OSC_STREAM_BACKOFF_MIN)
+#	define LV2_OSC_STREAM_BACKOFF_MIN 100
+#endif
+#if !defined(LV2_OSC_STREAM_BACKOFF_MAX)
+#	define LV2_OSC_STREAM_BACKOFF_MAX 10000
+#endif
+
+// ms after which a pending TCP connect is abandoned
+#if !defined(LV2_OSC_STREAM_CONNECT_TIMEOUT)
+#	define LV2_OSC_STREAM_CONNECT_TIMEOUT 5000
+#endif
+
+// shared memory ring pair between processes, opt-in as it needs varchunk.h
+// and Linux futexes, must be the same for all users of LV2_OSC_Stream
+#if !defined(LV2_OSC_STREAM_SHM)
+#	define LV2_OSC_STREAM_SHM 0
+#endif
+
+#if LV2_OSC_STREAM_SHM && !defined(__linux__)
+#	error "LV2_OSC_STREAM_SHM needs Linux"
+#endif
+
+// body size of each shared memory ring, must be a power of 2
+#if !defined(LV2_OSC_STREAM_SHM_SIZE)
+#	define LV2_OSC_STREAM_SHM_SIZE 0x40000 // 256K
+#endif
+
+#if LV2_OSC_STREAM_SHM && (LV2_OSC_STREAM_SHM_SIZE & (LV2_OSC_STREAM_SHM_SIZE - 1))
+#	error "LV2_OSC_STREAM_SHM_SIZE must be a power of 2"
+#endif
+
+// vectorized search for SLIP special bytes, 0 falls back to scalar code
+#if !defined(LV2_OSC_STREAM_SIMD)
+#	if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+#		define LV2_OSC_STREAM_SIMD 1
+#	else
+#		define LV2_OSC_STREAM_SIMD 0
+#	endif
+#endif
+
+#if LV2_OSC_STREAM_SIMD
+#	if defined(__AVX2__) || defined(__SSE2__)
+#		include <immintrin.h>
+#	elif defined(__ARM_NEON)
+#		include <arm_neon.h>
+#	endif
+#endif
+
+// maximal number of file descriptors of a stream
+#define LV2_OSC_STREAM_FDS (LV2_OSC_STREAM_CLIENTS + 3)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -61,6 +241,9 @@ typedef void *
 typedef void
 (*LV2_OSC_Stream_Write_Advance)(void *data, size_t written);
 
+typedef size_t
+(*LV2_OSC_Stream_Write_Maximum)(void *data);
+
 typedef const void *
 (*LV2_OSC_Stream_Read_Request)(void *data, size_t *toread);
 
@@ -68,22 +251,93 @@ typedef void
 (*LV2_OSC_Stream_Read_Advance)(void *data);
 
 typedef struct _LV2_OSC_Address LV2_OSC_Address;
+typedef struct _LV2_OSC_Peer LV2_OSC_Peer;
+typedef struct _LV2_OSC_Rx LV2_OSC_Rx;
+typedef struct _LV2_OSC_Client LV2_OSC_Client;
 typedef struct _LV2_OSC_Driver LV2_OSC_Driver;
 typedef struct _LV2_OSC_Stream LV2_OSC_Stream;
+typedef struct _LV2_OSC_Resolve LV2_OSC_Resolve;
+#if LV2_OSC_STREAM_SHM
+typedef struct _LV2_OSC_Shm_Wake LV2_OSC_Shm_Wake;
+typedef struct _LV2_OSC_Shm LV2_OSC_Shm;
+#endif
 
 struct _LV2_OSC_Address {
 	socklen_t len;
 	union {
 		struct sockaddr_in in4;
 		struct sockaddr_in6 in6;
+		struct sockaddr_un un; // largest member
 	};
 };
 
+struct _LV2_OSC_Peer {
+	LV2_OSC_Address addr;
+	time_t seen; // monotonic seconds of last received datagram, 0 if unused
+	uint64_t sent;
+	uint64_t received;
+};
+
+// frame assembly of a TCP connection or serial device
+struct _LV2_OSC_Rx {
+	size_t off; // bytes received
+	size_t skip; // bytes left of a prefix frame exceeding LV2_OSC_STREAM_FRAME_MAX,
+		// or non-zero while skipping such a SLIP frame
+	uint8_t *big; // heap buffer for frames exceeding buf, NULL if unused
+	size_t size; // of big
+	uint8_t buf [0x4000];
+};
+
+struct _LV2_OSC_Client {
+	int fd; // -1 if unused
+	LV2_OSC_Address addr;
+	size_t tx_off; // bytes of staged frames sent already
+	int64_t stalled; // ms since which it blocks the others, 0 if not
+	LV2_OSC_Rx rx;
+};
+
+#if LV2_OSC_STREAM_SHM
+// shared memory region of osc.shm:// streams, followed by two varchunk_t
+// rings of 'size' bytes body each, the first from server to client, the second
+// from client to server
+#define LV2_OSC_STREAM_SHM_MAGIC 0x4f534302 // 'OSC' + layout version 2
+
+struct _LV2_OSC_Shm_Wake {
+	atomic_uint seq; // futex word, bumped by producer after writes
+	atomic_uint waiting; // consumer is about to block on seq
+};
+
+struct _LV2_OSC_Shm {
+	atomic_uint magic; // set by server once rings are initialized, 0 upon exit
+	uint32_t size;
+	atomic_uint clients; // number of attached clients, at most one
+	atomic_int pid; // server process, tells regions left behind by crashes
+	LV2_OSC_Shm_Wake wake [2];
+	uint8_t rings [] __attribute__((aligned(64)));
+};
+#endif
+
+// background host name resolution, shared by stream and resolver thread
+struct _LV2_OSC_Resolve {
+	atomic_int refs;
+	atomic_bool done;
+	int err; // of getaddrinfo
+	struct addrinfo hints;
+	LV2_OSC_Address addr;
+	char node [NI_MAXHOST];
+	char service [NI_MAXSERV];
+};
+
 struct _LV2_OSC_Driver {
 	LV2_OSC_Stream_Write_Request write_req;
 	LV2_OSC_Stream_Write_Advance write_adv;
 	LV2_OSC_Stream_Read_Request read_req;
 	LV2_OSC_Stream_Read_Advance read_adv;
+	LV2_OSC_Stream_Read_Request read_next; // optional, packet following the one
+		// returned last, lets TCP and serial streams stage many packets before
+		// they are released with read_adv once written, one at a time if NULL
+	LV2_OSC_Stream_Write_Maximum write_max; // optional, largest packet write_req
+		// ever grants, larger received frames are skipped, unbounded if NULL
 };
 
 struct _LV2_OSC_Stream {
@@ -93,17 +347,120 @@ struct _LV2_OSC_Stream {
 	bool server;
 	bool slip;
 	bool serial;
+	bool shm;
 	bool connected;
+	bool multicast; // UDP client with group address as peer
 	int sock;
 	int fd;
 	LV2_OSC_Address self;
 	LV2_OSC_Address peer;
+	dev_t dev; // of Unix socket or shared memory region created as server, only
+	ino_t ino; // removed upon close if its name still refers to it
 	const LV2_OSC_Driver *driv;
 	void *data;
 	uint8_t tx_buf [0x4000];
-	uint8_t rx_buf [0x4000];
-	size_t rx_off;
+	size_t tx_off; // bytes of staged frames sent already, TCP client and serial
+	size_t tx_len; // bytes of frames staged in tx_buf, TCP and serial
+	size_t tx_ext; // bytes of an oversized prefix framed packet following
+		// tx_buf, sent straight from the ring
+	size_t tx_part; // bytes of an oversized SLIP framed packet encoded already
+	size_t tx_cnt; // packets of staged frames, released from the ring once written
+	LV2_OSC_Rx rx; // TCP client and serial
 	char url [PATH_MAX];
+	LV2_OSC_Peer peers [LV2_OSC_STREAM_PEERS]; // UDP server only
+	int peer_sel; // index of selected peer or LV2_OSC_STREAM_PEER_ALL
+	LV2_OSC_Client clients [LV2_OSC_STREAM_CLIENTS]; // TCP server only
+	struct {
+		LV2_OSC_Resolve *job; // pending, NULL if none
+		LV2_OSC_Address addr; // cached result
+		char node [NI_MAXHOST];
+		char service [NI_MAXSERV];
+		int64_t expiry; // monotonic ms, 0 if nothing cached
+	} resolve; // clients only
+	struct {
+		bool pending; // non-blocking connect in progress
+		int64_t since; // monotonic ms of connect attempt
+		int64_t retry; // monotonic ms of next attempt
+		int backoff; // ms, 0 after success
+	} conn; // clients only
+	struct {
+		bool uring;
+		char iface [IF_NAMESIZE]; // multicast interface
+		int ttl; // multicast hops
+		int loop; // multicast loopback to local sockets
+		unsigned baud; // serial line speed
+		int parity; // serial parity, 0 none, 1 odd, 2 even
+		int flow; // serial flow control, 0 none, 1 RTS/CTS, 2 XON/XOFF
+		int vmin; // serial bytes pending before reported as readable
+	} opts; // from URL query, e.g. osc.udp://:2222?uring
+#if LV2_OSC_STREAM_URING
+	struct {
+		int fd; // -1 if unused
+		bool armed; // multishot receive pending
+		bool held; // receive completion waits for ring space
+		unsigned to_submit;
+		unsigned inflight; // sends pending completion
+		unsigned sq_entries;
+		unsigned sq_tail;
+		unsigned *sq_khead;
+		unsigned *sq_ktail;
+		unsigned *sq_kmask;
+		unsigned *sq_karray;
+		unsigned *cq_khead;
+		unsigned *cq_ktail;
+		unsigned *cq_kmask;
+		struct io_uring_sqe *sqes;
+		struct io_uring_cqe *cqes;
+		uint8_t *sq_ptr;
+		size_t sq_len;
+		uint8_t *cq_ptr;
+		size_t cq_len;
+		size_t sqes_len;
+		struct io_uring_buf_ring *br;
+		size_t br_len;
+		uint8_t *bufs;
+		uint16_t br_tail;
+		struct msghdr rx_msg;
+		struct msghdr tx_msg [LV2_OSC_STREAM_URING_DEPTH];
+		struct iovec tx_iov [LV2_OSC_STREAM_URING_DEPTH];
+		int tx_peer [LV2_OSC_STREAM_URING_DEPTH];
+		LV2_OSC_Address tx_name [LV2_OSC_STREAM_URING_DEPTH];
+		uint64_t tx_cancel; // sends canceled by a failed one in their chain
+	} uring;
+#endif
+#if LV2_OSC_STREAM_SHM
+	struct {
+		LV2_OSC_Shm *map; // NULL if unattached
+		size_t len;
+		varchunk_t *tx;
+		varchunk_t *rx;
+		LV2_OSC_Shm_Wake *tx_wake;
+		LV2_OSC_Shm_Wake *rx_wake;
+		_Atomic(LV2_OSC_Shm_Wake *) waker; // rx_wake while mapped, for other threads
+		atomic_uint wakers; // other threads in lv2_osc_stream_wake
+		char name [NAME_MAX];
+	} shmem;
+#endif
+#if LV2_OSC_STREAM_MMSG
+	struct {
+		bool tx_fallback;
+		bool rx_fallback;
+		unsigned itx;
+		unsigned ntx;
+		unsigned irx;
+		unsigned nrx;
+		size_t tx_off;
+		struct mmsghdr tx [LV2_OSC_STREAM_MMSG];
+		struct iovec tx_iov [LV2_OSC_STREAM_MMSG];
+		int tx_peer [LV2_OSC_STREAM_MMSG];
+		LV2_OSC_Address tx_name [LV2_OSC_STREAM_MMSG]; // peer slots may be reused
+		struct mmsghdr rx [LV2_OSC_STREAM_MMSG];
+		struct iovec rx_iov [LV2_OSC_STREAM_MMSG][2];
+		struct sockaddr_storage rx_name [LV2_OSC_STREAM_MMSG];
+		uint8_t rx_buf [LV2_OSC_STREAM_MMSG][LV2_OSC_STREAM_MMSG_SIZE];
+		uint8_t rx_spill [LV2_OSC_STREAM_MMSG_SPILL];
+	} mmsg;
+#endif
 };
 
 typedef enum _LV2_OSC_Enum {
@@ -120,37 +477,129 @@ static const char *udp_prefix = "osc.udp://";
 static const char *tcp_prefix = "osc.tcp://";
 static const char *tcp_slip_prefix = "osc.slip.tcp://";
 static const char *tcp_prefix_prefix = "osc.prefix.tcp://";
+static const char *unix_prefix = "osc.unix://";
+static const char *unix_slip_prefix = "osc.unix.slip://";
+static const char *shm_prefix = "osc.shm://";
 static const char *ser_prefix = "osc.serial://";
-//FIXME serial
 
+#if LV2_OSC_STREAM_TERMIOS2
+// kernel struct termios2, as <asm/termbits.h> clashes with <termios.h>
+typedef struct _LV2_OSC_Termios2 LV2_OSC_Termios2;
+
+struct _LV2_OSC_Termios2 {
+	tcflag_t c_iflag;
+	tcflag_t c_oflag;
+	tcflag_t c_cflag;
+	tcflag_t c_lflag;
+	cc_t c_line;
+	cc_t c_cc [19];
+	speed_t c_ispeed;
+	speed_t c_ospeed;
+};
+
+#	define LV2_OSC_STREAM_TCGETS2 _IOR('T', 0x2A, LV2_OSC_Termios2)
+#	define LV2_OSC_STREAM_TCSETS2 _IOW('T', 0x2B, LV2_OSC_Termios2)
+#	define LV2_OSC_STREAM_BOTHER 0010000
+#endif
+
+// speed constant of standard serial line speeds, B0 for others
+static inline speed_t
+_lv2_osc_stream_speed(unsigned baud)
+{
+	switch(baud)
+	{
+		case 1200: return B1200;
+		case 2400: return B2400;
+		case 4800: return B4800;
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+#if defined(B460800)
+		case 460800: return B460800;
+#endif
+#if defined(B921600)
+		case 921600: return B921600;
+#endif
+#if defined(B1000000)
+		case 1000000: return B1000000;
+#endif
+#if defined(B2000000)
+		case 2000000: return B2000000;
+#endif
+#if defined(B3000000)
+		case 3000000: return B3000000;
+#endif
+#if defined(B4000000)
+		case 4000000: return B4000000;
+#endif
+	}
+
+	return B0;
+}
 
+// raw 8-bit line with speed, parity and flow control from URL options
 static inline int
-_lv2_osc_stream_interface_attribs(int fd, int speed)
+_lv2_osc_stream_interface_attribs(LV2_OSC_Stream *stream, int fd)
 {
 	struct termios tty;
+	const speed_t speed = _lv2_osc_stream_speed(stream->opts.baud);
+
+#if !LV2_OSC_STREAM_TERMIOS2
+	if(speed == B0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+#endif
 
 	if(tcgetattr(fd, &tty) < 0)
 	{
 		return -1;
 	}
 
-	cfsetospeed(&tty, (speed_t)speed);
-	cfsetispeed(&tty, (speed_t)speed);
+	if(speed != B0)
+	{
+		cfsetospeed(&tty, speed);
+		cfsetispeed(&tty, speed);
+	}
 
 	tty.c_cflag |= (CLOCAL | CREAD);    /* ignore modem controls */
 	tty.c_cflag &= ~CSIZE;
 	tty.c_cflag |= CS8;         /* 8-bit characters */
-	tty.c_cflag &= ~PARENB;     /* no parity bit */
 	tty.c_cflag &= ~CSTOPB;     /* only need 1 stop bit */
-	tty.c_cflag &= ~CRTSCTS;    /* no hardware flowcontrol */
 
-	/* setup for non-canonical mode */
-	tty.c_iflag &= ~(IGNCR | ONLCR | IXON);
-	tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+	tty.c_cflag &= ~(PARENB | PARODD);
+	if(stream->opts.parity == 1)
+	{
+		tty.c_cflag |= (PARENB | PARODD);
+	}
+	else if(stream->opts.parity == 2)
+	{
+		tty.c_cflag |= PARENB;
+	}
+
+	tty.c_cflag &= ~CRTSCTS;
+	tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+	if(stream->opts.flow == 1)
+	{
+		tty.c_cflag |= CRTSCTS;
+	}
+	else if(stream->opts.flow == 2)
+	{
+		tty.c_iflag |= (IXON | IXOFF);
+	}
+
+	/* setup for non-canonical mode, pass bytes unaltered */
+	tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
+	tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ECHONL | ISIG | IEXTEN);
 	tty.c_oflag &= ~OPOST;
 
-	/* fetch bytes as they become available */
-	tty.c_cc[VMIN] = 0;
+	/* reads never block, but polling waits for vmin bytes to batch reads, a
+	 * non-zero VTIME would make polling report single bytes again */
+	tty.c_cc[VMIN] = stream->opts.vmin;
 	tty.c_cc[VTIME] = 0;
 
 	if(tcsetattr(fd, TCSANOW, &tty) != 0)
@@ -158,11 +607,38 @@ _lv2_osc_stream_interface_attribs(int fd, int speed)
 		return -1;
 	}
 
+#if LV2_OSC_STREAM_TERMIOS2
+	if(speed == B0) // arbitrary speed
+	{
+		LV2_OSC_Termios2 tty2;
+
+		if(ioctl(fd, LV2_OSC_STREAM_TCGETS2, &tty2) == -1)
+		{
+			return -1;
+		}
+
+		tty2.c_cflag &= ~CBAUD;
+		tty2.c_cflag |= LV2_OSC_STREAM_BOTHER;
+		tty2.c_ispeed = stream->opts.baud;
+		tty2.c_ospeed = stream->opts.baud;
+
+		if(ioctl(fd, LV2_OSC_STREAM_TCSETS2, &tty2) == -1)
+		{
+			return -1;
+		}
+	}
+#endif
+
 	return 0;
 }
 
 #define LV2_OSC_STREAM_ERRNO(EV, ERRNO) ( (EV & (~LV2_OSC_ERR)) | (ERRNO) )
 
+#define SLIP_END					0300	// 0xC0, 192, indicates end of packet
+#define SLIP_ESC					0333	// 0xDB, 219, indicates byte stuffing
+#define SLIP_END_REPLACE	0334	// 0xDC, 220, ESC ESC_END means END data byte
+#define SLIP_ESC_REPLACE	0335	// 0xDD, 221, ESC ESC_ESC means ESC data byte
+
 static inline void
 _close_socket(int *fd)
 {
@@ -177,966 +653,3893 @@ _close_socket(int *fd)
 	}
 }
 
-static inline int
-lv2_osc_stream_deinit(LV2_OSC_Stream *stream)
+#if LV2_OSC_STREAM_URING
+static inline void
+_lv2_osc_stream_uring_deinit(LV2_OSC_Stream *stream)
 {
-	_close_socket(&stream->fd);
-	_close_socket(&stream->sock);
+	if(stream->uring.fd >= 0) // cancels pending operations
+	{
+		close(stream->uring.fd);
+		stream->uring.fd = -1;
+	}
 
-	return 0;
+	if(stream->uring.br)
+	{
+		munmap(stream->uring.br, stream->uring.br_len);
+		stream->uring.br = NULL;
+	}
+
+	if(stream->uring.sqes)
+	{
+		munmap(stream->uring.sqes, stream->uring.sqes_len);
+		stream->uring.sqes = NULL;
+	}
+
+	if(stream->uring.cq_ptr && (stream->uring.cq_ptr != stream->uring.sq_ptr) )
+	{
+		munmap(stream->uring.cq_ptr, stream->uring.cq_len);
+	}
+	stream->uring.cq_ptr = NULL;
+
+	if(stream->uring.sq_ptr)
+	{
+		munmap(stream->uring.sq_ptr, stream->uring.sq_len);
+		stream->uring.sq_ptr = NULL;
+	}
+
+	stream->uring.armed = false;
+	stream->uring.held = false;
+	stream->uring.to_submit = 0;
+	stream->uring.inflight = 0;
+	stream->uring.tx_cancel = 0;
+}
+
+static inline void
+_lv2_osc_stream_uring_buf_add(LV2_OSC_Stream *stream, unsigned bid)
+{
+	const unsigned mask = LV2_OSC_STREAM_URING_BUFS - 1;
+	struct io_uring_buf *buf = &stream->uring.br->bufs[stream->uring.br_tail & mask];
+
+	buf->addr = (uintptr_t)(stream->uring.bufs + bid*LV2_OSC_STREAM_URING_BUF_SIZE);
+	buf->len = LV2_OSC_STREAM_URING_BUF_SIZE;
+	buf->bid = bid;
+
+	stream->uring.br_tail += 1;
+}
+
+static inline void
+_lv2_osc_stream_uring_buf_publish(LV2_OSC_Stream *stream)
+{
+	__atomic_store_n(&stream->uring.br->tail, stream->uring.br_tail,
+		__ATOMIC_RELEASE);
 }
 
+// set up ring with provided buffers, streams fall back to plain syscalls on failure
 static inline int
-_lv2_osc_stream_reinit(LV2_OSC_Stream *stream)
+_lv2_osc_stream_uring_init(LV2_OSC_Stream *stream)
 {
-	LV2_OSC_Enum ev = LV2_OSC_NONE;
-	lv2_osc_stream_deinit(stream);
+	struct io_uring_params params;
 
-	char *dup = strdup(stream->url);
-	if(!dup)
+	memset(&params, 0x0, sizeof(params));
+
+	stream->uring.fd = syscall(__NR_io_uring_setup, LV2_OSC_STREAM_URING_DEPTH,
+		&params);
+	if(stream->uring.fd < 0)
 	{
-		ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
 		goto fail;
 	}
 
-	char *ptr = dup;
-	char *tmp;
+	stream->uring.sq_len = params.sq_off.array
+		+ params.sq_entries * sizeof(unsigned);
+	stream->uring.cq_len = params.cq_off.cqes
+		+ params.cq_entries * sizeof(struct io_uring_cqe);
 
-	if(strncmp(ptr, udp_prefix, strlen(udp_prefix)) == 0)
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
 	{
-		stream->slip = false;
-		stream->socket_family = AF_INET;
-		stream->socket_type = SOCK_DGRAM;
-		stream->protocol = IPPROTO_UDP;
-		ptr += strlen(udp_prefix);
+		if(stream->uring.cq_len > stream->uring.sq_len)
+		{
+			stream->uring.sq_len = stream->uring.cq_len;
+		}
 	}
-	else if(strncmp(ptr, tcp_prefix, strlen(tcp_prefix)) == 0)
+
+	stream->uring.sq_ptr = mmap(NULL, stream->uring.sq_len,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, stream->uring.fd,
+		IORING_OFF_SQ_RING);
+	if(stream->uring.sq_ptr == MAP_FAILED)
 	{
-		stream->slip = true;
-		stream->socket_family = AF_INET;
-		stream->socket_type = SOCK_STREAM;
-		stream->protocol = IPPROTO_TCP;
-		ptr += strlen(tcp_prefix);
+		stream->uring.sq_ptr = NULL;
+		goto fail;
 	}
-	else if(strncmp(ptr, tcp_slip_prefix, strlen(tcp_slip_prefix)) == 0)
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
 	{
-		stream->slip = true;
-		stream->socket_family = AF_INET;
-		stream->socket_type = SOCK_STREAM;
-		stream->protocol = IPPROTO_TCP;
-		ptr += strlen(tcp_slip_prefix);
+		stream->uring.cq_ptr = stream->uring.sq_ptr;
 	}
-	else if(strncmp(ptr, tcp_prefix_prefix, strlen(tcp_prefix_prefix)) == 0)
+	else
 	{
-		stream->slip = false;
-		stream->socket_family = AF_INET;
-		stream->socket_type = SOCK_STREAM;
-		stream->protocol = IPPROTO_TCP;
-		ptr += strlen(tcp_prefix_prefix);
+		stream->uring.cq_ptr = mmap(NULL, stream->uring.cq_len,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, stream->uring.fd,
+			IORING_OFF_CQ_RING);
+		if(stream->uring.cq_ptr == MAP_FAILED)
+		{
+			stream->uring.cq_ptr = NULL;
+			goto fail;
+		}
 	}
-	else if(strncmp(ptr, ser_prefix, strlen(ser_prefix)) == 0)
+
+	stream->uring.sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	stream->uring.sqes = mmap(NULL, stream->uring.sqes_len,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, stream->uring.fd,
+		IORING_OFF_SQES);
+	if(stream->uring.sqes == MAP_FAILED)
 	{
-		stream->slip = true;
-		stream->serial = true;
-		ptr += strlen(ser_prefix);
+		stream->uring.sqes = NULL;
+		goto fail;
 	}
-	else
+
+	stream->uring.sq_entries = params.sq_entries;
+	stream->uring.sq_khead = (unsigned *)(stream->uring.sq_ptr + params.sq_off.head);
+	stream->uring.sq_ktail = (unsigned *)(stream->uring.sq_ptr + params.sq_off.tail);
+	stream->uring.sq_kmask = (unsigned *)(stream->uring.sq_ptr + params.sq_off.ring_mask);
+	stream->uring.sq_karray = (unsigned *)(stream->uring.sq_ptr + params.sq_off.array);
+	stream->uring.sq_tail = *stream->uring.sq_ktail;
+	stream->uring.cq_khead = (unsigned *)(stream->uring.cq_ptr + params.cq_off.head);
+	stream->uring.cq_ktail = (unsigned *)(stream->uring.cq_ptr + params.cq_off.tail);
+	stream->uring.cq_kmask = (unsigned *)(stream->uring.cq_ptr + params.cq_off.ring_mask);
+	stream->uring.cqes = (struct io_uring_cqe *)(stream->uring.cq_ptr + params.cq_off.cqes);
+
+	// page aligned buffer ring, followed by the buffers themselves
+	const size_t ring_len = LV2_OSC_STREAM_URING_BUFS * sizeof(struct io_uring_buf);
+
+	stream->uring.br_len = ring_len
+		+ LV2_OSC_STREAM_URING_BUFS * LV2_OSC_STREAM_URING_BUF_SIZE;
+	stream->uring.br = mmap(NULL, stream->uring.br_len, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(stream->uring.br == MAP_FAILED)
 	{
-		ev = LV2_OSC_STREAM_ERRNO(ev, ENOPROTOOPT);
+		stream->uring.br = NULL;
 		goto fail;
 	}
+	stream->uring.bufs = (uint8_t *)stream->uring.br + ring_len;
 
-	if(ptr[0] == '\0')
+	struct io_uring_buf_reg reg;
+
+	memset(&reg, 0x0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)stream->uring.br;
+	reg.ring_entries = LV2_OSC_STREAM_URING_BUFS;
+	reg.bgid = 0;
+
+	if(syscall(__NR_io_uring_register, stream->uring.fd,
+		IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
 	{
-		ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
 		goto fail;
 	}
 
-	if(stream->serial)
+	stream->uring.br_tail = 0;
+	for(unsigned i = 0; i < LV2_OSC_STREAM_URING_BUFS; i++)
 	{
-		stream->sock = open(ptr, O_RDWR | O_NOCTTY | O_NDELAY);
-		if(stream->sock < 0)
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+		_lv2_osc_stream_uring_buf_add(stream, i);
+	}
+	_lv2_osc_stream_uring_buf_publish(stream);
 
-		if(fcntl(stream->sock, F_SETFL, FNDELAY) == -1) //FIXME
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+	// template for multishot receive, reserves space for sender address
+	memset(&stream->uring.rx_msg, 0x0, sizeof(struct msghdr));
+	stream->uring.rx_msg.msg_namelen = sizeof(struct sockaddr_in6);
 
-		if(_lv2_osc_stream_interface_attribs(stream->sock, B115200) == -1)
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+	return 0;
 
-		stream->connected = true;
-	}
-	else // !stream->serial
-	{
-		const char *node = NULL;
-		const char *iface = NULL;
-		const char *service = NULL;
+fail:
+	_lv2_osc_stream_uring_deinit(stream);
 
-		// optional IPv6
-		if(ptr[0] == '[')
-		{
-			stream->socket_family = AF_INET6;
-			++ptr;
-		}
+	return 1;
+}
+#endif
 
-		node = ptr;
+// remember file created as server by its identity, as its name may be taken
+// over by a successor before we are closed
+static inline void
+_lv2_osc_stream_own(LV2_OSC_Stream *stream, const struct stat *st)
+{
+	stream->dev = st->st_dev;
+	stream->ino = st->st_ino;
+}
 
-		// optional IPv6
-		if( (tmp = strchr(ptr, '%')) )
-		{
-			if(stream->socket_family != AF_INET6)
-			{
-				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-				goto fail;
-			}
+static inline bool
+_lv2_osc_stream_owns(LV2_OSC_Stream *stream, const struct stat *st)
+{
+	return stream->ino && (st->st_dev == stream->dev)
+		&& (st->st_ino == stream->ino);
+}
 
-			ptr = tmp;
+#if LV2_OSC_STREAM_SHM
+static inline void
+_lv2_osc_stream_shm_deinit(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Shm *map = stream->shmem.map;
+
+	if(!map)
+	{
+		return;
+	}
+
+	stream->shmem.map = NULL;
+
+	// let threads currently waking us up leave the region before unmapping
+	atomic_store_explicit(&stream->shmem.waker, NULL, memory_order_seq_cst);
+	while(atomic_load_explicit(&stream->shmem.wakers, memory_order_seq_cst))
+	{
+		sched_yield();
+	}
+
+	if(stream->server)
+	{
+		// tell attached client to let go
+		atomic_store_explicit(&map->magic, 0, memory_order_release);
+
+		struct stat st;
+		const int fd = shm_open(stream->shmem.name, O_RDONLY, 0);
+		if(fd >= 0)
+		{
+			if( (fstat(fd, &st) == 0) && _lv2_osc_stream_owns(stream, &st) )
+			{
+				shm_unlink(stream->shmem.name);
+			}
+
+			close(fd);
+		}
+
+		stream->ino = 0;
+	}
+	else
+	{
+		atomic_fetch_sub_explicit(&map->clients, 1, memory_order_release);
+	}
+
+	munmap(map, stream->shmem.len);
+	stream->connected = false;
+}
+#endif
+
+static inline void
+_lv2_osc_stream_resolve_release(LV2_OSC_Resolve *job)
+{
+	if(atomic_fetch_sub_explicit(&job->refs, 1, memory_order_acq_rel) == 1)
+	{
+		free(job);
+	}
+}
+
+static inline uint8_t *
+_lv2_osc_rx_buf(LV2_OSC_Rx *rx)
+{
+	return rx->big ? rx->big : rx->buf;
+}
+
+static inline size_t
+_lv2_osc_rx_size(const LV2_OSC_Rx *rx)
+{
+	return rx->big ? rx->size : sizeof(rx->buf);
+}
+
+// grow assembly buffer to hold at least need bytes, up to max
+static inline bool
+_lv2_osc_rx_grow(LV2_OSC_Rx *rx, size_t need, size_t max)
+{
+	size_t size = _lv2_osc_rx_size(rx);
+
+	if(need <= size)
+	{
+		return true;
+	}
+
+	while(size < need)
+	{
+		size <<= 1;
+	}
+
+	if(size > max)
+	{
+		size = max;
+	}
+
+	if(need > size)
+	{
+		return false;
+	}
+
+	uint8_t *big = realloc(rx->big, size);
+
+	if(!big)
+	{
+		return false;
+	}
+
+	if(!rx->big)
+	{
+		memcpy(big, rx->buf, rx->off);
+	}
+
+	rx->big = big;
+	rx->size = size;
+
+	return true;
+}
+
+// return to fixed buffer once the assembled rest fits into it
+static inline void
+_lv2_osc_rx_trim(LV2_OSC_Rx *rx)
+{
+	if(rx->big && (rx->off < sizeof(rx->buf)) )
+	{
+		memcpy(rx->buf, rx->big, rx->off);
+		free(rx->big);
+		rx->big = NULL;
+		rx->size = 0;
+	}
+}
+
+// drop partial frames, e.g. of a closed connection
+static inline void
+_lv2_osc_rx_reset(LV2_OSC_Rx *rx)
+{
+	free(rx->big);
+	rx->big = NULL;
+	rx->size = 0;
+	rx->off = 0;
+	rx->skip = 0;
+}
+
+// release packets of staged frames written completely, drop the others, which
+// stay in the ring to be staged again
+static inline void
+_lv2_osc_stream_unstage(LV2_OSC_Stream *stream, size_t written)
+{
+	size_t done = 0;
+
+	if(written == stream->tx_len + stream->tx_ext)
+	{
+		done = stream->tx_cnt;
+	}
+	else if(stream->slip) // double ended frames
+	{
+		size_t ends = 0;
+
+		for(size_t i = 0; i < written; i++)
+		{
+			if(stream->tx_buf[i] == SLIP_END)
+			{
+				ends += 1;
+			}
+		}
+
+		done = ends / 2;
+	}
+	else // uint32_t prefix frames
+	{
+		for(size_t off = 0; off + sizeof(uint32_t) <= stream->tx_len; done++)
+		{
+			uint32_t prefix;
+
+			memcpy(&prefix, stream->tx_buf + off, sizeof(uint32_t));
+			off += sizeof(uint32_t) + ntohl(prefix);
+
+			if(off > written)
+			{
+				break;
+			}
+		}
+	}
+
+	if(done > stream->tx_cnt) // released early
+	{
+		done = stream->tx_cnt;
+	}
+
+	for( ; done; done--)
+	{
+		stream->driv->read_adv(stream->data);
+	}
+
+	stream->tx_off = 0;
+	stream->tx_len = 0;
+	stream->tx_ext = 0;
+	stream->tx_part = 0;
+	stream->tx_cnt = 0;
+}
+
+// close everything, but keep background resolution going, e.g. for reinit
+static inline void
+_lv2_osc_stream_close(LV2_OSC_Stream *stream)
+{
+#if LV2_OSC_STREAM_URING
+	_lv2_osc_stream_uring_deinit(stream);
+#endif
+#if LV2_OSC_STREAM_SHM
+	_lv2_osc_stream_shm_deinit(stream);
+#endif
+
+	// staged frames written to every connected client
+	size_t written = stream->tx_off;
+	bool any = false;
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+	{
+		if( (stream->clients[i].fd >= 0)
+			&& (!any || (stream->clients[i].tx_off < written)) )
+		{
+			written = stream->clients[i].tx_off;
+			any = true;
+		}
+
+		_close_socket(&stream->clients[i].fd);
+		_lv2_osc_rx_reset(&stream->clients[i].rx);
+		stream->clients[i].tx_off = 0;
+	}
+
+	// packets of partially or unsent frames are staged again from their start
+	_lv2_osc_stream_unstage(stream, written);
+
+	// drop partial frames of previous connection
+	_lv2_osc_rx_reset(&stream->rx);
+
+	if( (stream->sock >= 0) && stream->server && (stream->socket_family == AF_UNIX) )
+	{
+		struct stat st;
+
+		if( (lstat(stream->self.un.sun_path, &st) == 0)
+			&& _lv2_osc_stream_owns(stream, &st) )
+		{
+			unlink(stream->self.un.sun_path);
+		}
+
+		stream->ino = 0;
+	}
+
+	_close_socket(&stream->fd);
+	_close_socket(&stream->sock);
+
+	stream->conn.pending = false;
+}
+
+static inline int
+lv2_osc_stream_deinit(LV2_OSC_Stream *stream)
+{
+	_lv2_osc_stream_close(stream);
+
+	// resolver thread frees an orphaned job itself, e.g. never wait for it
+	if(stream->resolve.job)
+	{
+		_lv2_osc_stream_resolve_release(stream->resolve.job);
+		stream->resolve.job = NULL;
+	}
+
+	return 0;
+}
+
+static inline int64_t
+_lv2_osc_stream_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+// delay next attempt of a failing client exponentially
+static inline void
+_lv2_osc_stream_backoff(LV2_OSC_Stream *stream)
+{
+	stream->conn.backoff = stream->conn.backoff
+		? stream->conn.backoff * 2
+		: LV2_OSC_STREAM_BACKOFF_MIN;
+
+	if(stream->conn.backoff > LV2_OSC_STREAM_BACKOFF_MAX)
+	{
+		stream->conn.backoff = LV2_OSC_STREAM_BACKOFF_MAX;
+	}
+
+	stream->conn.retry = _lv2_osc_stream_now_ms() + stream->conn.backoff;
+}
+
+// non-rt resolver thread
+static void *
+_lv2_osc_stream_resolver(void *data)
+{
+	LV2_OSC_Resolve *job = data;
+	struct addrinfo *res;
+
+	job->err = getaddrinfo(job->node, job->service, &job->hints, &res);
+	if(job->err == 0)
+	{
+		if(res->ai_addrlen <= sizeof(struct sockaddr_in6))
+		{
+			job->addr.len = res->ai_addrlen;
+			memcpy(&job->addr.in6, res->ai_addr, res->ai_addrlen);
+		}
+		else
+		{
+			job->err = EAI_FAMILY;
+		}
+
+		freeaddrinfo(res);
+	}
+
+	atomic_store_explicit(&job->done, true, memory_order_release);
+	_lv2_osc_stream_resolve_release(job);
+
+	return NULL;
+}
+
+// resolve without blocking: numeric hosts right away, names from cache or in
+// background, returns 0 when resolved or EINPROGRESS while pending
+static inline int
+_lv2_osc_stream_resolve(LV2_OSC_Stream *stream, const char *node,
+	const char *service, LV2_OSC_Address *addr)
+{
+	struct addrinfo hints;
+	struct addrinfo *res;
+
+	memset(&hints, 0x0, sizeof(struct addrinfo));
+	hints.ai_family = stream->socket_family;
+	hints.ai_socktype = stream->socket_type;
+	hints.ai_protocol = stream->protocol;
+	hints.ai_flags = AI_NUMERICHOST;
+
+	const int err = getaddrinfo(node, service, &hints, &res);
+	if(err == 0)
+	{
+		const bool fits = (res->ai_addrlen <= sizeof(struct sockaddr_in6));
+
+		if(fits)
+		{
+			addr->len = res->ai_addrlen;
+			memcpy(&addr->in6, res->ai_addr, res->ai_addrlen);
+		}
+
+		freeaddrinfo(res);
+
+		return fits ? 0 : EPROTOTYPE;
+	}
+	else if(err != EAI_NONAME)
+	{
+		return EADDRNOTAVAIL;
+	}
+
+	const int64_t now = _lv2_osc_stream_now_ms();
+	LV2_OSC_Resolve *job = stream->resolve.job;
+
+	if(job)
+	{
+		if(!atomic_load_explicit(&job->done, memory_order_acquire))
+		{
+			return EINPROGRESS;
+		}
+
+		stream->resolve.job = NULL;
+
+		if(job->err)
+		{
+			_lv2_osc_stream_resolve_release(job);
+			return EADDRNOTAVAIL;
+		}
+
+		stream->resolve.addr = job->addr;
+		strcpy(stream->resolve.node, job->node);
+		strcpy(stream->resolve.service, job->service);
+		stream->resolve.expiry = now + LV2_OSC_STREAM_RESOLVE_TTL*1000;
+
+		_lv2_osc_stream_resolve_release(job);
+	}
+
+	if( (stream->resolve.expiry > now)
+		&& !strcmp(stream->resolve.node, node)
+		&& !strcmp(stream->resolve.service, service)
+		&& (stream->resolve.addr.in6.sin6_family == stream->socket_family) )
+	{
+		*addr = stream->resolve.addr;
+		return 0;
+	}
+
+	if( (strlen(node) >= sizeof(stream->resolve.node))
+		|| (strlen(service) >= sizeof(stream->resolve.service)) )
+	{
+		return ENAMETOOLONG;
+	}
+
+	if(!(job = calloc(1, sizeof(LV2_OSC_Resolve))))
+	{
+		return ENOMEM;
+	}
+
+	atomic_init(&job->refs, 2); // stream + resolver thread
+	atomic_init(&job->done, false);
+	job->hints = hints;
+	job->hints.ai_flags = 0;
+	strcpy(job->node, node);
+	strcpy(job->service, service);
+
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	const int terr = pthread_create(&thread, &attr, _lv2_osc_stream_resolver, job);
+	pthread_attr_destroy(&attr);
+
+	if(terr)
+	{
+		free(job);
+		return terr;
+	}
+
+	stream->resolve.job = job;
+
+	return EINPROGRESS;
+}
+
+// start non-blocking connect of a stream client, completed in
+// _lv2_osc_stream_run_tcp
+static inline LV2_OSC_Enum
+_lv2_osc_stream_connect(LV2_OSC_Stream *stream)
+{
+	if(connect(stream->sock, (struct sockaddr *)&stream->peer.in6,
+		stream->peer.len) == 0)
+	{
+		stream->connected = true;
+		stream->conn.backoff = 0;
+		return LV2_OSC_NONE;
+	}
+
+	if(errno == EINPROGRESS)
+	{
+		stream->conn.pending = true;
+		stream->conn.since = _lv2_osc_stream_now_ms();
+		return LV2_OSC_NONE;
+	}
+
+	// e.g. refused right away, not fatal, retried by lv2_osc_stream_run
+	_close_socket(&stream->sock);
+	_lv2_osc_stream_backoff(stream);
+
+	return LV2_OSC_NONE;
+}
+
+// parse URL query options, e.g. osc.udp://:2222?uring
+static inline int
+_lv2_osc_stream_options(LV2_OSC_Stream *stream, char *opts)
+{
+	char *saveptr = NULL;
+
+	for(char *opt = strtok_r(opts, "&", &saveptr);
+		opt;
+		opt = strtok_r(NULL, "&", &saveptr))
+	{
+		char *val = strchr(opt, '=');
+
+		if(val)
+		{
+			*val++ = '\0';
+		}
+
+		if(!strcmp(opt, "uring"))
+		{
+			stream->opts.uring = val ? (atoi(val) != 0) : true;
+		}
+		else if(!strcmp(opt, "iface") && val && (strlen(val) < IF_NAMESIZE) )
+		{
+			strcpy(stream->opts.iface, val);
+		}
+		else if(!strcmp(opt, "ttl") && val)
+		{
+			stream->opts.ttl = atoi(val);
+
+			if( (stream->opts.ttl < 0) || (stream->opts.ttl > 255) )
+			{
+				return EINVAL;
+			}
+		}
+		else if(!strcmp(opt, "loop"))
+		{
+			stream->opts.loop = val ? (atoi(val) != 0) : true;
+		}
+		else if(!strcmp(opt, "baud") && val)
+		{
+			const long baud = atol(val);
+
+			if( (baud <= 0) || (baud > INT32_MAX) )
+			{
+				return EINVAL;
+			}
+
+			stream->opts.baud = baud;
+		}
+		else if(!strcmp(opt, "parity") && val)
+		{
+			if(!strcmp(val, "none"))
+				stream->opts.parity = 0;
+			else if(!strcmp(val, "odd"))
+				stream->opts.parity = 1;
+			else if(!strcmp(val, "even"))
+				stream->opts.parity = 2;
+			else
+				return EINVAL;
+		}
+		else if(!strcmp(opt, "flow") && val)
+		{
+			if(!strcmp(val, "none"))
+				stream->opts.flow = 0;
+			else if(!strcmp(val, "rtscts"))
+				stream->opts.flow = 1;
+			else if(!strcmp(val, "xonxoff"))
+				stream->opts.flow = 2;
+			else
+				return EINVAL;
+		}
+		else if(!strcmp(opt, "vmin") && val)
+		{
+			stream->opts.vmin = atoi(val);
+
+			if( (stream->opts.vmin < 0) || (stream->opts.vmin > 255) )
+			{
+				return EINVAL;
+			}
+		}
+		else
+		{
+			return EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static inline int
+_lv2_osc_stream_reuseport(LV2_OSC_Stream *stream)
+{
+#if !defined(__linux__) && defined(SO_REUSEPORT)
+	// BSDs only share multicast ports with SO_REUSEPORT
+	const int reuseport = 1;
+
+	if(setsockopt(stream->sock, SOL_SOCKET,
+		SO_REUSEPORT, &reuseport, sizeof(reuseport)) == -1)
+	{
+		return -1;
+	}
+#else
+	(void)stream;
+#endif
+
+	return 0;
+}
+
+// join group of peer address and route outgoing packets to it
+static inline int
+_lv2_osc_stream_join(LV2_OSC_Stream *stream, const char *iface)
+{
+	unsigned ifindex = 0;
+
+	if(stream->opts.iface[0])
+	{
+		iface = stream->opts.iface;
+	}
+
+	if(iface && !(ifindex = if_nametoindex(iface)) )
+	{
+		return -1;
+	}
+
+	if(stream->socket_family == AF_INET)
+	{
+		const unsigned char ttl = stream->opts.ttl;
+		const unsigned char loop = stream->opts.loop;
+#if defined(__linux__)
+		struct ip_mreqn mreq;
+		memset(&mreq, 0x0, sizeof(mreq));
+		mreq.imr_multiaddr = stream->peer.in4.sin_addr;
+		mreq.imr_address.s_addr = htonl(INADDR_ANY);
+		mreq.imr_ifindex = ifindex;
+
+		if(setsockopt(stream->sock, IPPROTO_IP,
+			IP_MULTICAST_IF, &mreq, sizeof(mreq)) == -1)
+		{
+			return -1;
+		}
+#else
+		struct ip_mreq mreq; // interface selection is IPv6 only here
+		memset(&mreq, 0x0, sizeof(mreq));
+		mreq.imr_multiaddr = stream->peer.in4.sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+#endif
+
+		if(  (setsockopt(stream->sock, IPPROTO_IP,
+				IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1)
+			|| (setsockopt(stream->sock, IPPROTO_IP,
+				IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == -1)
+			|| (setsockopt(stream->sock, IPPROTO_IP,
+				IP_MULTICAST_LOOP, &loop, sizeof(loop)) == -1) )
+		{
+			return -1;
+		}
+	}
+	else // AF_INET6
+	{
+		const int hops = stream->opts.ttl;
+		const unsigned loop = stream->opts.loop;
+		struct ipv6_mreq mreq;
+		memset(&mreq, 0x0, sizeof(mreq));
+		mreq.ipv6mr_multiaddr = stream->peer.in6.sin6_addr;
+		mreq.ipv6mr_interface = ifindex;
+
+		if(  (setsockopt(stream->sock, IPPROTO_IPV6,
+				IPV6_JOIN_GROUP, &mreq, sizeof(mreq)) == -1)
+			|| (setsockopt(stream->sock, IPPROTO_IPV6,
+				IPV6_MULTICAST_IF, &ifindex, sizeof(ifindex)) == -1)
+			|| (setsockopt(stream->sock, IPPROTO_IPV6,
+				IPV6_MULTICAST_HOPS, &hops, sizeof(hops)) == -1)
+			|| (setsockopt(stream->sock, IPPROTO_IPV6,
+				IPV6_MULTICAST_LOOP, &loop, sizeof(loop)) == -1) )
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// split host-local URL into role and path, e.g. /path (server) or
+// localhost/path (client)
+static inline const char *
+_lv2_osc_stream_local_path(LV2_OSC_Stream *stream, const char *ptr, int *err)
+{
+	const char *path = strchr(ptr, '/');
+
+	if(!path)
+	{
+		*err = EDESTADDRREQ;
+		return NULL;
+	}
+
+	if( (path != ptr) && ( (path - ptr != strlen("localhost"))
+		|| strncmp(ptr, "localhost", path - ptr) ) )
+	{
+		*err = EADDRNOTAVAIL;
+		return NULL;
+	}
+
+	stream->server = (path == ptr);
+
+	return path;
+}
+
+#if LV2_OSC_STREAM_SHM
+static inline varchunk_t *
+_lv2_osc_stream_shm_ring(LV2_OSC_Shm *map, unsigned idx)
+{
+	return (varchunk_t *)&map->rings[idx * (sizeof(varchunk_t) + map->size)];
+}
+
+// map region created by server, retried by client until it is ready
+static inline LV2_OSC_Enum
+_lv2_osc_stream_shm_attach(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	struct stat st;
+
+	const int fd = shm_open(stream->shmem.name, O_RDWR, 0);
+	if(fd < 0)
+	{
+		return (errno == ENOENT) ? ev : LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	if( (fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(LV2_OSC_Shm)) )
+	{
+		close(fd);
+		return ev; // not truncated yet
+	}
+
+	const size_t len = st.st_size;
+	LV2_OSC_Shm *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	if( (atomic_load_explicit(&map->magic, memory_order_acquire)
+			!= LV2_OSC_STREAM_SHM_MAGIC)
+		|| (map->size & (map->size - 1))
+		|| (sizeof(LV2_OSC_Shm) + 2*(sizeof(varchunk_t) + map->size) > len) )
+	{
+		munmap(map, len);
+		return ev; // not initialized yet or incompatible
+	}
+
+	stream->shmem.len = len;
+	stream->shmem.tx = _lv2_osc_stream_shm_ring(map, 1);
+	stream->shmem.rx = _lv2_osc_stream_shm_ring(map, 0);
+	stream->shmem.tx_wake = &map->wake[1];
+	stream->shmem.rx_wake = &map->wake[0];
+	stream->shmem.map = map;
+	stream->connected = true;
+	atomic_store_explicit(&stream->shmem.waker, stream->shmem.rx_wake,
+		memory_order_release);
+
+	atomic_fetch_add_explicit(&map->clients, 1, memory_order_release);
+
+	return ev;
+}
+
+// tell whether an existing region was left behind by a server that has gone
+// without cleaning up, regions still in use or of unknown layout are kept
+static inline bool
+_lv2_osc_stream_shm_stale(const char *name)
+{
+	struct stat st;
+	bool stale = false;
+
+	const int fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0)
+	{
+		return errno == ENOENT; // gone meanwhile, retry
+	}
+
+	if( (fstat(fd, &st) == 0) && ((size_t)st.st_size >= sizeof(LV2_OSC_Shm)) )
+	{
+		LV2_OSC_Shm *map = mmap(NULL, sizeof(LV2_OSC_Shm), PROT_READ, MAP_SHARED,
+			fd, 0);
+
+		if(map != MAP_FAILED)
+		{
+			const unsigned magic = atomic_load_explicit(&map->magic,
+				memory_order_acquire);
+			const pid_t pid = atomic_load_explicit(&map->pid, memory_order_acquire);
+
+			stale = ( (magic == LV2_OSC_STREAM_SHM_MAGIC) || (magic == 0) )
+				&& (pid > 0) && (kill(pid, 0) != 0) && (errno == ESRCH);
+
+			munmap(map, sizeof(LV2_OSC_Shm));
+		}
+	}
+
+	close(fd);
+
+	return stale;
+}
+
+// create (server) or attach to (client) a shared memory ring pair, e.g.
+// osc.shm:///eteroj or osc.shm://localhost/eteroj
+static inline LV2_OSC_Enum
+_lv2_osc_stream_reinit_shm(LV2_OSC_Stream *stream, const char *ptr)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	int err;
+
+	const char *name = _lv2_osc_stream_local_path(stream, ptr, &err);
+	if(!name)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, err);
+	}
+
+	if(strchr(name + 1, '/') || (name[1] == '\0'))
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, EINVAL);
+	}
+
+	if(strlen(name) >= sizeof(stream->shmem.name))
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, ENAMETOOLONG);
+	}
+
+	strcpy(stream->shmem.name, name);
+
+	if(!stream->server)
+	{
+		return _lv2_osc_stream_shm_attach(stream);
+	}
+
+	const size_t len = sizeof(LV2_OSC_Shm)
+		+ 2*(sizeof(varchunk_t) + LV2_OSC_STREAM_SHM_SIZE);
+
+	// never take over the region of a live server
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if( (fd < 0) && (errno == EEXIST) )
+	{
+		if(!_lv2_osc_stream_shm_stale(name))
+		{
+			return LV2_OSC_STREAM_ERRNO(ev, EADDRINUSE);
+		}
+
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+
+	if(fd < 0)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, (errno == EEXIST) ? EADDRINUSE : errno);
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) == 0)
+	{
+		_lv2_osc_stream_own(stream, &st);
+	}
+
+	if(ftruncate(fd, len) != 0)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+		close(fd);
+		shm_unlink(name);
+		return ev;
+	}
+
+	LV2_OSC_Shm *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(map == MAP_FAILED)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+		shm_unlink(name);
+		return ev;
+	}
+
+	mlock(map, len); // prevent memory from being flushed to disk
+
+	atomic_store_explicit(&map->pid, getpid(), memory_order_release);
+	map->size = LV2_OSC_STREAM_SHM_SIZE;
+	atomic_init(&map->clients, 0);
+	for(unsigned i = 0; i < 2; i++)
+	{
+		atomic_init(&map->wake[i].seq, 0);
+		atomic_init(&map->wake[i].waiting, 0);
+		varchunk_init(_lv2_osc_stream_shm_ring(map, i), map->size, true);
+	}
+
+	atomic_store_explicit(&map->magic, LV2_OSC_STREAM_SHM_MAGIC,
+		memory_order_release);
+
+	stream->shmem.len = len;
+	stream->shmem.tx = _lv2_osc_stream_shm_ring(map, 0);
+	stream->shmem.rx = _lv2_osc_stream_shm_ring(map, 1);
+	stream->shmem.tx_wake = &map->wake[0];
+	stream->shmem.rx_wake = &map->wake[1];
+	stream->shmem.map = map;
+	atomic_store_explicit(&stream->shmem.waker, stream->shmem.rx_wake,
+		memory_order_release);
+
+	return ev;
+}
+#endif
+
+// remove the socket of a previous server, but only if it is a socket and
+// nobody accepts on it anymore, else bind fails with EADDRINUSE
+static inline void
+_lv2_osc_stream_unlink_stale(LV2_OSC_Stream *stream, const LV2_OSC_Address *addr)
+{
+	struct stat st;
+
+	if( (lstat(addr->un.sun_path, &st) != 0) || !S_ISSOCK(st.st_mode) )
+	{
+		return;
+	}
+
+	const int probe = socket(AF_UNIX, stream->socket_type, 0);
+	if(probe < 0)
+	{
+		return;
+	}
+
+	// a live server with a full backlog must not stall us
+	if( (fcntl(probe, F_SETFL, O_NONBLOCK) == 0)
+		&& (connect(probe, (const struct sockaddr *)&addr->un, addr->len) != 0)
+		&& (errno == ECONNREFUSED) )
+	{
+		unlink(addr->un.sun_path);
+	}
+
+	close(probe);
+}
+
+// bind (server) or connect (client) an Unix domain socket, e.g.
+// osc.unix:///tmp/eteroj.sock or osc.unix://localhost/tmp/eteroj.sock
+static inline LV2_OSC_Enum
+_lv2_osc_stream_reinit_unix(LV2_OSC_Stream *stream, const char *ptr)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	int err;
+
+	const char *path = _lv2_osc_stream_local_path(stream, ptr, &err);
+	if(!path)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, err);
+	}
+
+	if(strlen(path) >= sizeof(stream->self.un.sun_path))
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, ENAMETOOLONG);
+	}
+
+	stream->sock = socket(stream->socket_family, stream->socket_type,
+		stream->protocol);
+
+	if(stream->sock < 0)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	if(fcntl(stream->sock, F_SETFL, O_NONBLOCK) == -1)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	const int sendbuff = LV2_OSC_STREAM_SNDBUF;
+	const int recvbuff = LV2_OSC_STREAM_RCVBUF;
+
+	if(setsockopt(stream->sock, SOL_SOCKET,
+		SO_SNDBUF, &sendbuff, sizeof(sendbuff)) == -1)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	if(setsockopt(stream->sock, SOL_SOCKET,
+		SO_RCVBUF, &recvbuff, sizeof(recvbuff)) == -1)
+	{
+		return LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+
+	LV2_OSC_Address *addr = stream->server ? &stream->self : &stream->peer;
+
+	memset(addr, 0x0, sizeof(LV2_OSC_Address));
+	addr->un.sun_family = AF_UNIX;
+	strcpy(addr->un.sun_path, path);
+	addr->len = offsetof(struct sockaddr_un, sun_path) + strlen(path) + 1;
+
+	if(stream->server)
+	{
+		_lv2_osc_stream_unlink_stale(stream, &stream->self);
+
+		if(bind(stream->sock, (struct sockaddr *)&stream->self.un,
+			stream->self.len) != 0)
+		{
+			return LV2_OSC_STREAM_ERRNO(ev, errno);
+		}
+
+		struct stat st;
+		if(lstat(path, &st) == 0)
+		{
+			_lv2_osc_stream_own(stream, &st);
+		}
+
+		if( (stream->socket_type == SOCK_STREAM)
+			&& (listen(stream->sock, LV2_OSC_STREAM_CLIENTS) != 0) )
+		{
+			// don't leave the path behind
+			const LV2_OSC_Enum err = LV2_OSC_STREAM_ERRNO(ev, errno);
+			unlink(path);
+			return err;
+		}
+	}
+	else if(stream->socket_type == SOCK_DGRAM) // client
+	{
+#if defined(__linux__)
+		// autobind to an unique abstract address, so the server can reply
+		memset(&stream->self, 0x0, sizeof(LV2_OSC_Address));
+		stream->self.un.sun_family = AF_UNIX;
+		stream->self.len = sizeof(sa_family_t);
+
+		if(bind(stream->sock, (struct sockaddr *)&stream->self.un,
+			stream->self.len) != 0)
+		{
+			return LV2_OSC_STREAM_ERRNO(ev, errno);
+		}
+#endif
+	}
+	else // SOCK_STREAM client
+	{
+		ev |= _lv2_osc_stream_connect(stream);
+	}
+
+	return ev;
+}
+
+static inline int
+_lv2_osc_stream_reinit(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	_lv2_osc_stream_close(stream);
+
+	memset(stream->peers, 0x0, sizeof(stream->peers));
+
+#if LV2_OSC_STREAM_MMSG
+	// drop staged packets
+	stream->mmsg.itx = 0;
+	stream->mmsg.ntx = 0;
+	stream->mmsg.tx_off = 0;
+#endif
+
+	char *dup = strdup(stream->url);
+	if(!dup)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
+		goto fail;
+	}
+
+	char *ptr = dup;
+	char *tmp;
+
+	if(strncmp(ptr, udp_prefix, strlen(udp_prefix)) == 0)
+	{
+		stream->slip = false;
+		stream->socket_family = AF_INET;
+		stream->socket_type = SOCK_DGRAM;
+		stream->protocol = IPPROTO_UDP;
+		ptr += strlen(udp_prefix);
+	}
+	else if(strncmp(ptr, tcp_prefix, strlen(tcp_prefix)) == 0)
+	{
+		stream->slip = true;
+		stream->socket_family = AF_INET;
+		stream->socket_type = SOCK_STREAM;
+		stream->protocol = IPPROTO_TCP;
+		ptr += strlen(tcp_prefix);
+	}
+	else if(strncmp(ptr, tcp_slip_prefix, strlen(tcp_slip_prefix)) == 0)
+	{
+		stream->slip = true;
+		stream->socket_family = AF_INET;
+		stream->socket_type = SOCK_STREAM;
+		stream->protocol = IPPROTO_TCP;
+		ptr += strlen(tcp_slip_prefix);
+	}
+	else if(strncmp(ptr, tcp_prefix_prefix, strlen(tcp_prefix_prefix)) == 0)
+	{
+		stream->slip = false;
+		stream->socket_family = AF_INET;
+		stream->socket_type = SOCK_STREAM;
+		stream->protocol = IPPROTO_TCP;
+		ptr += strlen(tcp_prefix_prefix);
+	}
+	else if(strncmp(ptr, unix_prefix, strlen(unix_prefix)) == 0)
+	{
+		stream->slip = false;
+		stream->socket_family = AF_UNIX;
+		stream->socket_type = SOCK_DGRAM;
+		stream->protocol = 0;
+		ptr += strlen(unix_prefix);
+	}
+	else if(strncmp(ptr, unix_slip_prefix, strlen(unix_slip_prefix)) == 0)
+	{
+		stream->slip = true;
+		stream->socket_family = AF_UNIX;
+		stream->socket_type = SOCK_STREAM;
+		stream->protocol = 0;
+		ptr += strlen(unix_slip_prefix);
+	}
+	else if(strncmp(ptr, shm_prefix, strlen(shm_prefix)) == 0)
+	{
+#if LV2_OSC_STREAM_SHM
+		stream->slip = false;
+		stream->shm = true;
+		stream->socket_family = AF_UNSPEC;
+		stream->socket_type = 0;
+		stream->protocol = 0;
+		ptr += strlen(shm_prefix);
+#else
+		ev = LV2_OSC_STREAM_ERRNO(ev, EPROTONOSUPPORT);
+		goto fail;
+#endif
+	}
+	else if(strncmp(ptr, ser_prefix, strlen(ser_prefix)) == 0)
+	{
+		stream->slip = true;
+		stream->serial = true;
+		ptr += strlen(ser_prefix);
+	}
+	else
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, ENOPROTOOPT);
+		goto fail;
+	}
+
+	memset(&stream->opts, 0x0, sizeof(stream->opts));
+	stream->opts.uring = (LV2_OSC_STREAM_URING == 2);
+	stream->opts.ttl = 1; // stay on local network
+	stream->opts.baud = 115200;
+	stream->multicast = false;
+
+	if( (tmp = strchr(ptr, '?')) )
+	{
+		int err;
+
+		tmp[0] = '\0';
+		if( (err = _lv2_osc_stream_options(stream, ++tmp)) )
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, err);
+			goto fail;
+		}
+	}
+
+	if(ptr[0] == '\0')
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
+		goto fail;
+	}
+
+	if(stream->serial)
+	{
+		stream->sock = open(ptr, O_RDWR | O_NOCTTY | O_NDELAY);
+		if(stream->sock < 0)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(fcntl(stream->sock, F_SETFL, FNDELAY) == -1) //FIXME
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(_lv2_osc_stream_interface_attribs(stream, stream->sock) == -1)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		stream->connected = true;
+	}
+#if LV2_OSC_STREAM_SHM
+	else if(stream->shm)
+	{
+		ev = _lv2_osc_stream_reinit_shm(stream, ptr);
+		if(ev & LV2_OSC_ERR)
+		{
+			goto fail;
+		}
+	}
+#endif
+	else if(stream->socket_family == AF_UNIX)
+	{
+		ev = _lv2_osc_stream_reinit_unix(stream, ptr);
+		if(ev & LV2_OSC_ERR)
+		{
+			goto fail;
+		}
+	}
+	else // !stream->serial
+	{
+		const char *node = NULL;
+		const char *iface = NULL;
+		const char *service = NULL;
+
+		// optional IPv6
+		if(ptr[0] == '[')
+		{
+			stream->socket_family = AF_INET6;
+			++ptr;
+		}
+
+		node = ptr;
+
+		// optional IPv6
+		if( (tmp = strchr(ptr, '%')) )
+		{
+			if(stream->socket_family != AF_INET6)
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+				goto fail;
+			}
+
+			ptr = tmp;
 			ptr[0] = '\0';
 			iface = ++ptr;
 		}
 
-		// optional IPv6
-		if( (tmp = strchr(ptr, ']')) )
-		if(ptr)
+		// optional IPv6
+		if( (tmp = strchr(ptr, ']')) )
+		if(ptr)
+		{
+			if(stream->socket_family != AF_INET6)
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
+				goto fail;
+			}
+
+			ptr = tmp;
+			ptr[0] = '\0';
+			++ptr;
+		}
+
+		// mandatory IPv4/6
+		ptr = strchr(ptr, ':');
+		if(!ptr)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
+			goto fail;
+		}
+
+		ptr[0] = '\0';
+
+		service = ++ptr;
+
+		if(strlen(node) == 0)
+		{
+			node = NULL;
+			stream->server = true;
+		}
+
+		stream->sock = socket(stream->socket_family, stream->socket_type,
+			stream->protocol);
+
+		if(stream->sock < 0)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(fcntl(stream->sock, F_SETFL, O_NONBLOCK) == -1)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		const int sendbuff = LV2_OSC_STREAM_SNDBUF;
+		const int recvbuff = LV2_OSC_STREAM_RCVBUF;
+		const int reuseaddr = 1;
+
+		if(setsockopt(stream->sock, SOL_SOCKET,
+			SO_SNDBUF, &sendbuff, sizeof(sendbuff)) == -1)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(setsockopt(stream->sock, SOL_SOCKET,
+			SO_RCVBUF, &recvbuff, sizeof(recvbuff)) == -1)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(setsockopt(stream->sock, SOL_SOCKET,
+			SO_REUSEADDR, &reuseaddr, sizeof(reuseaddr)) == -1)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			goto fail;
+		}
+
+		if(stream->socket_family == AF_INET) // IPv4
+		{
+			if(stream->server)
+			{
+				// resolve self address
+				struct addrinfo hints;
+				memset(&hints, 0x0, sizeof(struct addrinfo));
+				hints.ai_family = stream->socket_family;
+				hints.ai_socktype = stream->socket_type;
+				hints.ai_protocol = stream->protocol;
+
+				struct addrinfo *res;
+				if(getaddrinfo(node, service, &hints, &res) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+				if(res->ai_addrlen != sizeof(stream->peer.in4))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+					goto fail;
+				}
+
+				stream->self.len = res->ai_addrlen;
+				memcpy(&stream->self.in4, res->ai_addr, res->ai_addrlen);
+				stream->self.in4.sin_addr.s_addr = htonl(INADDR_ANY);
+
+				freeaddrinfo(res);
+
+				if(bind(stream->sock, (struct sockaddr *)&stream->self.in4,
+					stream->self.len) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+			else // client
+			{
+				// resolve peer address
+				const int err = _lv2_osc_stream_resolve(stream, node, service,
+					&stream->peer);
+				if(err == EINPROGRESS) // retried by lv2_osc_stream_run once resolved
+				{
+					goto fail;
+				}
+				else if(err)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, err);
+					goto fail;
+				}
+
+				stream->multicast = (stream->socket_type == SOCK_DGRAM)
+					&& IN_MULTICAST(ntohl(stream->peer.in4.sin_addr.s_addr));
+
+				// group members listen on the group's port
+				stream->self.len = sizeof(stream->self.in4);
+				stream->self.in4.sin_family = stream->socket_family;
+				stream->self.in4.sin_port = stream->multicast
+					? stream->peer.in4.sin_port
+					: htons(0);
+				stream->self.in4.sin_addr.s_addr = htonl(INADDR_ANY);
+
+				if(stream->multicast && _lv2_osc_stream_reuseport(stream))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(bind(stream->sock, (struct sockaddr *)&stream->self.in4,
+					stream->self.len) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+
+			if(stream->socket_type == SOCK_DGRAM)
+			{
+				const int broadcast = 1;
+
+				if(setsockopt(stream->sock, SOL_SOCKET, SO_BROADCAST,
+					&broadcast, sizeof(broadcast)) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(stream->multicast && _lv2_osc_stream_join(stream, iface))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+			else if(stream->socket_type == SOCK_STREAM)
+			{
+				const int flag = 1;
+
+				if(setsockopt(stream->sock, stream->protocol,
+					TCP_NODELAY, &flag, sizeof(flag)) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(setsockopt(stream->sock, SOL_SOCKET,
+					SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(stream->server)
+				{
+					if(listen(stream->sock, LV2_OSC_STREAM_CLIENTS) != 0)
+					{
+						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+						goto fail;
+					}
+				}
+				else // client
+				{
+					ev |= _lv2_osc_stream_connect(stream);
+				}
+			}
+			else
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+				goto fail;
+			}
+		}
+		else if(stream->socket_family == AF_INET6) // IPv6
+		{
+			if(stream->server)
+			{
+				// resolve self address
+				struct addrinfo hints;
+				memset(&hints, 0x0, sizeof(struct addrinfo));
+				hints.ai_family = stream->socket_family;
+				hints.ai_socktype = stream->socket_type;
+				hints.ai_protocol = stream->protocol;
+
+				struct addrinfo *res;
+				if(getaddrinfo(node, service, &hints, &res) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+				if(res->ai_addrlen != sizeof(stream->peer.in6))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+					goto fail;
+				}
+
+				stream->self.len = res->ai_addrlen;
+				memcpy(&stream->self.in6, res->ai_addr, res->ai_addrlen);
+				stream->self.in6.sin6_addr = in6addr_any;
+				if(iface)
+				{
+					stream->self.in6.sin6_scope_id = if_nametoindex(iface);
+				}
+
+				freeaddrinfo(res);
+
+				if(bind(stream->sock, (struct sockaddr *)&stream->self.in6,
+					stream->self.len) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+			else // client
+			{
+				// resolve peer address
+				const int err = _lv2_osc_stream_resolve(stream, node, service,
+					&stream->peer);
+				if(err == EINPROGRESS) // retried by lv2_osc_stream_run once resolved
+				{
+					goto fail;
+				}
+				else if(err)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, err);
+					goto fail;
+				}
+
+				if(iface)
+				{
+					stream->peer.in6.sin6_scope_id = if_nametoindex(iface);
+				}
+
+				stream->multicast = (stream->socket_type == SOCK_DGRAM)
+					&& IN6_IS_ADDR_MULTICAST(&stream->peer.in6.sin6_addr);
+
+				// group members listen on the group's port
+				stream->self.len = sizeof(stream->self.in6);
+				stream->self.in6.sin6_family = stream->socket_family;
+				stream->self.in6.sin6_port = stream->multicast
+					? stream->peer.in6.sin6_port
+					: htons(0);
+				stream->self.in6.sin6_addr = in6addr_any;
+				if(iface)
+				{
+					stream->self.in6.sin6_scope_id = if_nametoindex(iface);
+				}
+
+				if(stream->multicast && _lv2_osc_stream_reuseport(stream))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(bind(stream->sock, (struct sockaddr *)&stream->self.in6,
+					stream->self.len) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+
+			if(stream->socket_type == SOCK_DGRAM)
+			{
+				if(stream->multicast && _lv2_osc_stream_join(stream, iface))
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+			}
+			else if(stream->socket_type == SOCK_STREAM)
+			{
+				const int flag = 1;
+
+				if(setsockopt(stream->sock, stream->protocol,
+					TCP_NODELAY, &flag, sizeof(flag)) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(setsockopt(stream->sock, SOL_SOCKET,
+					SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
+				{
+					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+					goto fail;
+				}
+
+				if(stream->server)
+				{
+					if(listen(stream->sock, LV2_OSC_STREAM_CLIENTS) != 0)
+					{
+						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+						goto fail;
+					}
+				}
+				else // client
+				{
+					ev |= _lv2_osc_stream_connect(stream);
+				}
+			}
+			else
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+				goto fail;
+			}
+		}
+		else
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
+			goto fail;
+		}
+	}
+
+#if LV2_OSC_STREAM_URING
+	if( (stream->socket_type == SOCK_DGRAM) && (stream->socket_family != AF_UNIX)
+		&& stream->opts.uring)
+	{
+		_lv2_osc_stream_uring_init(stream);
+	}
+#endif
+
+	free(dup);
+
+	return ev;
+
+fail:
+	if(dup)
+	{
+		free(dup);
+	}
+
+	_close_socket(&stream->sock);
+
+	return ev;
+}
+
+static inline int
+lv2_osc_stream_init(LV2_OSC_Stream *stream, const char *url,
+	const LV2_OSC_Driver *driv, void *data)
+{
+	memset(stream, 0x0, sizeof(LV2_OSC_Stream));
+
+	strncpy(stream->url, url, sizeof(stream->url) - 1);
+	stream->driv = driv;
+	stream->data = data;
+	stream->sock = -1;
+	stream->fd = -1;
+	stream->peer_sel = LV2_OSC_STREAM_PEER_ALL;
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+	{
+		stream->clients[i].fd = -1;
+	}
+
+#if LV2_OSC_STREAM_URING
+	stream->uring.fd = -1;
+#endif
+
+	return _lv2_osc_stream_reinit(stream);
+}
+
+// first END or ESC byte in [src, end), end if there is none
+static inline const uint8_t *
+_lv2_osc_slip_scan(const uint8_t *src, const uint8_t *end)
+{
+#if LV2_OSC_STREAM_SIMD && defined(__AVX2__)
+	const __m256i slip_end = _mm256_set1_epi8((char)SLIP_END);
+	const __m256i slip_esc = _mm256_set1_epi8((char)SLIP_ESC);
+
+	for( ; end - src >= 32; src += 32)
+	{
+		const __m256i v = _mm256_loadu_si256((const __m256i *)src);
+		const uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_cmpeq_epi8(v, slip_end), _mm256_cmpeq_epi8(v, slip_esc)));
+
+		if(mask)
+		{
+			return src + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+#if LV2_OSC_STREAM_SIMD && (defined(__AVX2__) || defined(__SSE2__))
+	const __m128i slip_end_16 = _mm_set1_epi8((char)SLIP_END);
+	const __m128i slip_esc_16 = _mm_set1_epi8((char)SLIP_ESC);
+
+	for( ; end - src >= 16; src += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i *)src);
+		const uint32_t mask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(v, slip_end_16), _mm_cmpeq_epi8(v, slip_esc_16)));
+
+		if(mask)
+		{
+			return src + __builtin_ctz(mask);
+		}
+	}
+#elif LV2_OSC_STREAM_SIMD && defined(__ARM_NEON)
+	const uint8x16_t slip_end = vdupq_n_u8(SLIP_END);
+	const uint8x16_t slip_esc = vdupq_n_u8(SLIP_ESC);
+
+	for( ; end - src >= 16; src += 16)
+	{
+		const uint8x16_t v = vld1q_u8(src);
+		const uint8x16_t cmp = vorrq_u8(vceqq_u8(v, slip_end), vceqq_u8(v, slip_esc));
+		// narrow to 4 bits per byte, as there is no movemask
+		const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+			vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+
+		if(mask)
+		{
+			return src + (__builtin_ctzll(mask) >> 2);
+		}
+	}
+#endif
+
+	for( ; src < end; src++)
+	{
+		if( (*src == SLIP_END) || (*src == SLIP_ESC) )
+		{
+			break;
+		}
+	}
+
+	return src;
+}
+
+// SLIP encoding of src into dst in a single pass, returns 0 if exceeding max
+static inline size_t
+lv2_osc_slip_encode(uint8_t *dst, size_t max, const uint8_t *src, size_t len)
+{
+	const uint8_t *end = src + len;
+	uint8_t *ptr = dst;
+
+	if( (len == 0) || (max < len + 2) )
+	{
+		return 0;
+	}
+
+	*ptr++ = SLIP_END; // double ended SLIP
+
+	while(true)
+	{
+		const uint8_t *special = _lv2_osc_slip_scan(src, end);
+		const size_t run = special - src;
+
+		// copy clean run in bulk
+		memcpy(ptr, src, run);
+		ptr += run;
+		src = special;
+
+		if(src == end)
+		{
+			break;
+		}
+
+		// escape sequence, remaining input and trailing END must fit
+		if( (size_t)(ptr - dst) + 2 + (size_t)(end - src) > max)
+		{
+			return 0;
+		}
+
+		*ptr++ = SLIP_ESC;
+		*ptr++ = (*src++ == SLIP_END) ? SLIP_END_REPLACE : SLIP_ESC_REPLACE;
+	}
+
+	*ptr++ = SLIP_END;
+
+	return ptr - dst;
+}
+
+// SLIP encoding of as much of src as fits into dst without END delimiters,
+// e.g. for frames exceeding a single buffer, sets bytes consumed of src
+static inline size_t
+lv2_osc_slip_encode_part(uint8_t *dst, size_t max, const uint8_t *src,
+	size_t len, size_t *consumed)
+{
+	const uint8_t *from = src;
+	const uint8_t *end = src + len;
+	uint8_t *ptr = dst;
+	const uint8_t *stop = dst + max;
+
+	while(from < end)
+	{
+		// do not scan beyond what fits
+		const size_t room = stop - ptr;
+		const uint8_t *lim = ((size_t)(end - from) > room) ? from + room : end;
+		const uint8_t *special = _lv2_osc_slip_scan(from, lim);
+		const size_t run = special - from;
+
+		memcpy(ptr, from, run);
+		ptr += run;
+		from = special;
+
+		if( (from == lim) || (stop - ptr < 2) )
+		{
+			break; // done or full
+		}
+
+		*ptr++ = SLIP_ESC;
+		*ptr++ = (*from++ == SLIP_END) ? SLIP_END_REPLACE : SLIP_ESC_REPLACE;
+	}
+
+	*consumed = from - src;
+
+	return ptr - dst;
+}
+
+// SLIP encoding
+static inline size_t
+lv2_osc_slip_encode_inline(uint8_t *dst, size_t len)
+{
+	if(len == 0)
+		return 0;
+
+	const uint8_t *end = dst + len;
+
+	// estimate new size
+	size_t size = len + 2; // double ended SLIP
+	for(const uint8_t *from=_lv2_osc_slip_scan(dst, end);
+		from<end;
+		from=_lv2_osc_slip_scan(from + 1, end))
+	{
+		size++;
+	}
+
+	// fast track if no escaping needed
+	if(size == len + 2)
+	{
+		memmove(dst+1, dst, len);
+		dst[0] = SLIP_END;
+		dst[size-1] = SLIP_END;
+
+		return size;
+	}
+
+	// slow track if some escaping needed
+	uint8_t *to = dst + size - 1;
+	*to-- = SLIP_END;
+	for(const uint8_t *from=end-1; from>=dst; from--)
+	{
+		if(*from == SLIP_END)
+		{
+			*to-- = SLIP_END_REPLACE;
+			*to-- = SLIP_ESC;
+		}
+		else if(*from == SLIP_ESC)
+		{
+			*to-- = SLIP_ESC_REPLACE;
+			*to-- = SLIP_ESC;
+		}
+		else
+			*to-- = *from;
+	}
+	*to-- = SLIP_END;
+
+	return size;
+}
+
+// SLIP decoding of src into dst, which may be the same, clean runs between
+// special bytes are moved in bulk
+static inline size_t
+lv2_osc_slip_decode(uint8_t *dst, const uint8_t *begin, size_t len,
+	size_t *size)
+{
+	const uint8_t *src = begin;
+	const uint8_t *end = begin + len;
+	uint8_t *ptr = dst;
+
+	bool whole = false;
+
+	if( (src < end) && (*src == SLIP_END) )
+	{
+		 whole = true;
+		 src++;
+	}
+
+	// leave incomplete frames untouched for the next call
+	const uint8_t *stop = memchr(src, SLIP_END, end - src);
+
+	if(!stop)
+	{
+		*size = 0;
+		return 0;
+	}
+
+	end = stop + 1;
+
+	while(src < end)
+	{
+		const uint8_t *special = _lv2_osc_slip_scan(src, end);
+		const size_t run = special - src;
+
+		if(ptr != src)
+		{
+			memmove(ptr, src, run);
+		}
+		ptr += run;
+		src = special;
+
+		if(src == end)
+		{
+			break;
+		}
+
+		if(*src == SLIP_ESC)
+		{
+			src++;
+			if(*src == SLIP_END_REPLACE)
+				*ptr++ = SLIP_END;
+			else if(*src == SLIP_ESC_REPLACE)
+				*ptr++ = SLIP_ESC;
+			else if(*src == SLIP_END)
+				continue; // malformed escape, END still terminates frame
+			src++;
+		}
+		else // SLIP_END
+		{
+			src++;
+
+			*size = whole ? ptr - dst : 0;
+			return src - begin;
+		}
+	}
+
+	*size = 0;
+	return 0;
+}
+
+// SLIP decoding, in place
+static inline size_t
+lv2_osc_slip_decode_inline(uint8_t *dst, size_t len, size_t *size)
+{
+	return lv2_osc_slip_decode(dst, dst, len, size);
+}
+
+// upper bound of decoded size of a SLIP frame, without any END and ESC bytes
+static inline size_t
+_lv2_osc_slip_decoded_max(const uint8_t *src, size_t len)
+{
+	size_t size = len;
+
+	for(size_t i = 0; i < len; i++)
+	{
+		if( (src[i] == SLIP_END) || (src[i] == SLIP_ESC) )
+		{
+			size -= 1;
+		}
+	}
+
+	return size;
+}
+
+static inline time_t
+_lv2_osc_stream_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + 1; // never 0, which marks unused peer slots
+}
+
+static inline bool
+_lv2_osc_stream_address_equal(const LV2_OSC_Address *a, const LV2_OSC_Address *b)
+{
+	if( (a->len != b->len) || (a->in4.sin_family != b->in4.sin_family) )
+	{
+		return false;
+	}
+
+	if(a->un.sun_family == AF_UNIX)
+	{
+		return !memcmp(a->un.sun_path, b->un.sun_path,
+			a->len - offsetof(struct sockaddr_un, sun_path));
+	}
+
+	if(a->in4.sin_family == AF_INET6)
+	{
+		return (a->in6.sin6_port == b->in6.sin6_port)
+			&& (a->in6.sin6_scope_id == b->in6.sin6_scope_id)
+			&& !memcmp(&a->in6.sin6_addr, &b->in6.sin6_addr, sizeof(struct in6_addr));
+	}
+
+	return (a->in4.sin_port == b->in4.sin_port)
+		&& (a->in4.sin_addr.s_addr == b->in4.sin_addr.s_addr);
+}
+
+// remember sender of received datagram
+static inline void
+_lv2_osc_stream_peer_touch(LV2_OSC_Stream *stream, const void *addr,
+	socklen_t len, time_t now)
+{
+	if(stream->multicast) // keep sending to group
+	{
+		return;
+	}
+
+	// unnamed senders, e.g. unbound Unix domain sockets, can not be replied to
+	if( (len <= sizeof(sa_family_t)) || (len > sizeof(stream->peer.un)) )
+	{
+		return;
+	}
+
+	// most recent sender, as used by UDP clients
+	stream->peer.len = len;
+	memcpy(&stream->peer.in6, addr, len);
+
+	if(!stream->server)
+	{
+		return;
+	}
+
+	LV2_OSC_Peer *slot = NULL;
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_PEERS; i++)
+	{
+		LV2_OSC_Peer *peer = &stream->peers[i];
+
+		if(peer->seen && _lv2_osc_stream_address_equal(&peer->addr, &stream->peer))
+		{
+			slot = peer;
+			break;
+		}
+	}
+
+	if(!slot) // new peer, take an unused slot or replace least recent one
+	{
+		for(unsigned i = 0; i < LV2_OSC_STREAM_PEERS; i++)
+		{
+			LV2_OSC_Peer *peer = &stream->peers[i];
+
+			if(!slot || (peer->seen < slot->seen) )
+			{
+				slot = peer;
+			}
+		}
+
+		if(stream->peer_sel == slot - stream->peers)
+		{
+			stream->peer_sel = LV2_OSC_STREAM_PEER_ALL;
+		}
+
+		memset(slot, 0x0, sizeof(LV2_OSC_Peer));
+		slot->addr = stream->peer;
+	}
+
+	slot->seen = now;
+	slot->received += 1;
+}
+
+static inline void
+_lv2_osc_stream_peer_expire(LV2_OSC_Stream *stream, time_t now)
+{
+#if LV2_OSC_STREAM_PEER_TIMEOUT
+	for(unsigned i = 0; i < LV2_OSC_STREAM_PEERS; i++)
+	{
+		LV2_OSC_Peer *peer = &stream->peers[i];
+
+		if(peer->seen && (now - peer->seen >= LV2_OSC_STREAM_PEER_TIMEOUT) )
+		{
+			if(stream->peer_sel == (int)i)
+			{
+				stream->peer_sel = LV2_OSC_STREAM_PEER_ALL;
+			}
+
+			memset(peer, 0x0, sizeof(LV2_OSC_Peer));
+		}
+	}
+#else
+	(void)stream;
+	(void)now;
+#endif
+}
+
+// collect destinations of outgoing packets, -1 denotes the client peer
+static inline unsigned
+_lv2_osc_stream_peer_dests(LV2_OSC_Stream *stream, int dst [LV2_OSC_STREAM_PEERS])
+{
+	unsigned ndst = 0;
+
+	if(!stream->server)
+	{
+		if(stream->peer.len) // has a peer
+		{
+			dst[ndst++] = -1;
+		}
+	}
+	else if(stream->peer_sel != LV2_OSC_STREAM_PEER_ALL)
+	{
+		if(stream->peers[stream->peer_sel].seen)
+		{
+			dst[ndst++] = stream->peer_sel;
+		}
+	}
+	else
+	{
+		for(unsigned i = 0; i < LV2_OSC_STREAM_PEERS; i++)
+		{
+			if(stream->peers[i].seen)
+			{
+				dst[ndst++] = i;
+			}
+		}
+	}
+
+	return ndst;
+}
+
+static inline LV2_OSC_Address *
+_lv2_osc_stream_peer_address(LV2_OSC_Stream *stream, int dst)
+{
+	return (dst < 0)
+		? &stream->peer
+		: &stream->peers[dst].addr;
+}
+
+static inline void
+_lv2_osc_stream_peer_sent(LV2_OSC_Stream *stream, int dst)
+{
+	if(dst >= 0)
+	{
+		stream->peers[dst].sent += 1;
+	}
+}
+
+static inline LV2_OSC_Enum
+_lv2_osc_stream_send_udp(LV2_OSC_Stream *stream, const uint8_t *buf, size_t tosend,
+	int dst, bool *blocked)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	const LV2_OSC_Address *addr = _lv2_osc_stream_peer_address(stream, dst);
+
+	const ssize_t sent = sendto(stream->sock, buf, tosend, 0,
+		(const struct sockaddr *)&addr->in6, addr->len);
+
+	*blocked = false;
+
+	if(sent == -1)
+	{
+		if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+		{
+			// full queue
+			*blocked = true;
+			return ev;
+		}
+
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
+	else if(sent != (ssize_t)tosend)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
+	}
+	else
+	{
+		_lv2_osc_stream_peer_sent(stream, dst);
+		ev |= LV2_OSC_SEND;
+	}
+
+	return ev;
+}
+
+// fan out single packet, only blocks if not sent to any destination yet
+static inline LV2_OSC_Enum
+_lv2_osc_stream_send_udp_dests(LV2_OSC_Stream *stream, const uint8_t *buf,
+	size_t tosend, const int *dst, unsigned ndst, bool *blocked)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	*blocked = false;
+
+	for(unsigned j = 0; j < ndst; j++)
+	{
+		bool full;
+
+		ev |= _lv2_osc_stream_send_udp(stream, buf, tosend, dst[j], &full);
+
+		if(full)
+		{
+			*blocked = (j == 0);
+			break; // drop for remaining destinations
+		}
+	}
+
+	return ev;
+}
+
+#if LV2_OSC_STREAM_MMSG
+static inline LV2_OSC_Enum
+_lv2_osc_stream_send_udp_mmsg(LV2_OSC_Stream *stream, const int *dst,
+	unsigned ndst)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	while(true)
+	{
+		// stage as many packets as fit into tx_buf, as the ring only exposes its head,
+		// fanned out packets share a single iovec
+		while(stream->mmsg.ntx + ndst <= LV2_OSC_STREAM_MMSG)
+		{
+			const uint8_t *buf;
+			size_t tosend;
+
+			if( !(buf = stream->driv->read_req(stream->data, &tosend)) )
+			{
+				break;
+			}
+
+			if(stream->mmsg.tx_off + tosend > sizeof(stream->tx_buf))
+			{
+				if(stream->mmsg.ntx > 0)
+				{
+					break; // flush batch first
+				}
+
+				// too large to be staged, send directly from ring
+				bool blocked;
+				const LV2_OSC_Enum ev1 = _lv2_osc_stream_send_udp_dests(stream, buf,
+					tosend, dst, ndst, &blocked);
+
+				if(blocked)
+				{
+					return ev;
+				}
+
+				ev |= ev1;
+				if(ev1 & LV2_OSC_ERR)
+				{
+					return ev;
+				}
+
+				stream->driv->read_adv(stream->data);
+				continue;
+			}
+
+			uint8_t *buf_dst = stream->tx_buf + stream->mmsg.tx_off;
+			memcpy(buf_dst, buf, tosend);
+			stream->driv->read_adv(stream->data);
+
+			struct iovec *iov = &stream->mmsg.tx_iov[stream->mmsg.ntx];
+
+			iov->iov_base = buf_dst;
+			iov->iov_len = tosend;
+
+			for(unsigned j = 0; j < ndst; j++)
+			{
+				LV2_OSC_Address *addr = &stream->mmsg.tx_name[stream->mmsg.ntx];
+				struct mmsghdr *msg = &stream->mmsg.tx[stream->mmsg.ntx];
+
+				// copy, as staged packets may outlive their peer's slot
+				*addr = *_lv2_osc_stream_peer_address(stream, dst[j]);
+
+				memset(msg, 0x0, sizeof(struct mmsghdr));
+				msg->msg_hdr.msg_name = (void *)&addr->in6;
+				msg->msg_hdr.msg_namelen = addr->len;
+				msg->msg_hdr.msg_iov = iov;
+				msg->msg_hdr.msg_iovlen = 1;
+
+				stream->mmsg.tx_peer[stream->mmsg.ntx] = dst[j];
+				stream->mmsg.ntx += 1;
+			}
+
+			stream->mmsg.tx_off += LV2_OSC_PADDED_SIZE(tosend);
+		}
+
+		if(stream->mmsg.itx == stream->mmsg.ntx) // nothing staged
 		{
-			if(stream->socket_family != AF_INET6)
+			break;
+		}
+
+		const int sent = sendmmsg(stream->sock, &stream->mmsg.tx[stream->mmsg.itx],
+			stream->mmsg.ntx - stream->mmsg.itx, 0);
+
+		if(sent == -1)
+		{
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+			{
+				// full queue, keep staged packets for next call
+				break;
+			}
+
+			if(errno == ENOSYS)
+			{
+				stream->mmsg.tx_fallback = true;
+
+				for(unsigned i = stream->mmsg.itx; i < stream->mmsg.ntx; i++)
+				{
+					const struct iovec *iov = stream->mmsg.tx[i].msg_hdr.msg_iov;
+					bool blocked;
+
+					ev |= _lv2_osc_stream_send_udp(stream, iov->iov_base, iov->iov_len,
+						stream->mmsg.tx_peer[i], &blocked);
+				}
+			}
+			else
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			}
+
+			// drop staged packets
+			stream->mmsg.itx = 0;
+			stream->mmsg.ntx = 0;
+			stream->mmsg.tx_off = 0;
+			break;
+		}
+
+		for(int i = 0; i < sent; i++)
+		{
+			const unsigned itx = stream->mmsg.itx + i;
+			const struct mmsghdr *msg = &stream->mmsg.tx[itx];
+
+			if(msg->msg_len != msg->msg_hdr.msg_iov->iov_len)
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
+			}
+			else
+			{
+				_lv2_osc_stream_peer_sent(stream, stream->mmsg.tx_peer[itx]);
+				ev |= LV2_OSC_SEND;
+			}
+		}
+
+		stream->mmsg.itx += sent;
+
+		if(stream->mmsg.itx < stream->mmsg.ntx)
+		{
+			// full queue, keep remaining staged packets for next call
+			break;
+		}
+
+		stream->mmsg.itx = 0;
+		stream->mmsg.ntx = 0;
+		stream->mmsg.tx_off = 0;
+	}
+
+	return ev;
+}
+
+static inline bool
+_lv2_osc_stream_recv_udp_mmsg(LV2_OSC_Stream *stream, time_t now,
+	LV2_OSC_Enum *ev)
+{
+	bool drained = false;
+
+	while(true)
+	{
+		// hand over received datagrams, keep them until ring has space
+		while(stream->mmsg.irx < stream->mmsg.nrx)
+		{
+			const unsigned i = stream->mmsg.irx;
+			const struct mmsghdr *msg = &stream->mmsg.rx[i];
+			const size_t len = msg->msg_len;
+
+			if(len > 0)
+			{
+				uint8_t *buf = stream->driv->write_req(stream->data, len, NULL);
+
+				if(!buf)
+				{
+					return true; // ring full, retry in next run
+				}
+
+				if(len > LV2_OSC_STREAM_MMSG_SIZE)
+				{
+					memcpy(buf, stream->mmsg.rx_buf[i], LV2_OSC_STREAM_MMSG_SIZE);
+					memcpy(buf + LV2_OSC_STREAM_MMSG_SIZE, stream->mmsg.rx_spill,
+						len - LV2_OSC_STREAM_MMSG_SIZE);
+				}
+				else
+				{
+					memcpy(buf, stream->mmsg.rx_buf[i], len);
+				}
+
+				_lv2_osc_stream_peer_touch(stream, &stream->mmsg.rx_name[i],
+					msg->msg_hdr.msg_namelen, now);
+
+				stream->driv->write_adv(stream->data, len);
+				*ev |= LV2_OSC_RECV;
+			}
+
+			stream->mmsg.irx += 1;
+		}
+
+		if(drained)
+		{
+			return true;
+		}
+
+		// only receive as many datagrams as ring has space for
+		size_t max_len;
+		if(!stream->driv->write_req(stream->data, LV2_OSC_STREAM_REQBUF, &max_len))
+		{
+			return true; // ring full, retry in next run
+		}
+
+		unsigned n = max_len / (LV2_OSC_STREAM_MMSG_SIZE + 2*sizeof(uint64_t));
+		if(n == 0)
+		{
+			return false; // let recvfrom fill up remaining space in ring
+		}
+		else if(n > LV2_OSC_STREAM_MMSG)
+		{
+			n = LV2_OSC_STREAM_MMSG;
+		}
+
+		for(unsigned i = 0; i < n; i++)
+		{
+			struct iovec *iov = stream->mmsg.rx_iov[i];
+			struct mmsghdr *msg = &stream->mmsg.rx[i];
+
+			iov[0].iov_base = stream->mmsg.rx_buf[i];
+			iov[0].iov_len = LV2_OSC_STREAM_MMSG_SIZE;
+			iov[1].iov_base = stream->mmsg.rx_spill;
+			iov[1].iov_len = LV2_OSC_STREAM_MMSG_SPILL;
+
+			memset(msg, 0x0, sizeof(struct mmsghdr));
+			msg->msg_hdr.msg_name = &stream->mmsg.rx_name[i];
+			msg->msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+			msg->msg_hdr.msg_iov = iov;
+			msg->msg_hdr.msg_iovlen = 2;
+		}
+
+		const int recvd = recvmmsg(stream->sock, stream->mmsg.rx, n, 0, NULL);
+
+		if(recvd == -1)
+		{
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+			{
+				// empty queue
+				return true;
+			}
+
+			if(errno == ENOSYS)
+			{
+				stream->mmsg.rx_fallback = true;
+				return false;
+			}
+
+			*ev = LV2_OSC_STREAM_ERRNO(*ev, errno);
+			return true;
+		}
+
+		// only the last datagram spilled into the shared buffer is intact
+		struct mmsghdr *spilled = NULL;
+
+		for(int i = 0; i < recvd; i++)
+		{
+			struct mmsghdr *msg = &stream->mmsg.rx[i];
+
+			if(msg->msg_hdr.msg_flags & MSG_TRUNC)
+			{
+				msg->msg_len = 0;
+				*ev = LV2_OSC_STREAM_ERRNO(*ev, EMSGSIZE);
+			}
+			else if(msg->msg_len > LV2_OSC_STREAM_MMSG_SIZE)
+			{
+				if(spilled)
+				{
+					spilled->msg_len = 0;
+					*ev = LV2_OSC_STREAM_ERRNO(*ev, EMSGSIZE);
+				}
+
+				spilled = msg;
+			}
+		}
+
+		stream->mmsg.irx = 0;
+		stream->mmsg.nrx = recvd;
+		drained = (unsigned)recvd < n;
+	}
+}
+#endif
+
+#if LV2_OSC_STREAM_URING
+#define LV2_OSC_STREAM_URING_RECV UINT64_MAX
+
+static inline unsigned
+_lv2_osc_stream_uring_space(LV2_OSC_Stream *stream)
+{
+	const unsigned head = __atomic_load_n(stream->uring.sq_khead, __ATOMIC_ACQUIRE);
+
+	return stream->uring.sq_entries - (stream->uring.sq_tail - head);
+}
+
+static inline struct io_uring_sqe *
+_lv2_osc_stream_uring_sqe(LV2_OSC_Stream *stream)
+{
+	if(_lv2_osc_stream_uring_space(stream) == 0)
+	{
+		return NULL;
+	}
+
+	const unsigned idx = stream->uring.sq_tail & *stream->uring.sq_kmask;
+	struct io_uring_sqe *sqe = &stream->uring.sqes[idx];
+
+	memset(sqe, 0x0, sizeof(struct io_uring_sqe));
+	stream->uring.sq_karray[idx] = idx;
+	stream->uring.sq_tail += 1;
+	stream->uring.to_submit += 1;
+
+	return sqe;
+}
+
+// hand received datagram over to ring, returns false to keep the completion
+// for the next run if the ring is full
+static inline bool
+_lv2_osc_stream_uring_recv(LV2_OSC_Stream *stream,
+	const struct io_uring_cqe *cqe, time_t now, LV2_OSC_Enum *ev)
+{
+	if( (cqe->res >= 0) && (cqe->flags & IORING_CQE_F_BUFFER) )
+	{
+		const unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		const uint8_t *buf = stream->uring.bufs + bid*LV2_OSC_STREAM_URING_BUF_SIZE;
+		const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out *)buf;
+		const uint8_t *name = buf + sizeof(struct io_uring_recvmsg_out);
+		const uint8_t *payload = name + stream->uring.rx_msg.msg_namelen
+			+ stream->uring.rx_msg.msg_controllen;
+
+		if(out->flags & MSG_TRUNC)
+		{
+			*ev = LV2_OSC_STREAM_ERRNO(*ev, EMSGSIZE);
+		}
+		else if(out->payloadlen > 0)
+		{
+			uint8_t *dst = stream->driv->write_req(stream->data, out->payloadlen, NULL);
+
+			if(!dst)
+			{
+				return false;
+			}
+
+			const socklen_t namelen = (out->namelen < stream->uring.rx_msg.msg_namelen)
+				? out->namelen
+				: stream->uring.rx_msg.msg_namelen;
+
+			memcpy(dst, payload, out->payloadlen);
+
+			_lv2_osc_stream_peer_touch(stream, name, namelen, now);
+
+			stream->driv->write_adv(stream->data, out->payloadlen);
+			*ev |= LV2_OSC_RECV;
+		}
+
+		// hand buffer back to kernel
+		_lv2_osc_stream_uring_buf_add(stream, bid);
+	}
+	else if( (cqe->res < 0) && (cqe->res != -ENOBUFS) ) // out of buffers, just rearm
+	{
+		*ev = LV2_OSC_STREAM_ERRNO(*ev, -cqe->res);
+	}
+
+	if(!(cqe->flags & IORING_CQE_F_MORE)) // multishot receive has terminated
+	{
+		stream->uring.armed = false;
+	}
+
+	return true;
+}
+
+static inline bool
+_lv2_osc_stream_uring_send(LV2_OSC_Stream *stream, unsigned itx,
+	struct io_uring_sqe **last)
+{
+	struct io_uring_sqe *sqe = _lv2_osc_stream_uring_sqe(stream);
+
+	if(!sqe)
+	{
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = stream->sock;
+	sqe->addr = (uintptr_t)&stream->uring.tx_msg[itx];
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->user_data = itx;
+
+	stream->uring.inflight += 1;
+	*last = sqe;
+
+	return true;
+}
+
+// stage linked sends in tx_buf, linking keeps them in order even if some have
+// to wait for socket space, returns number of staged sends
+static inline unsigned
+_lv2_osc_stream_uring_stage(LV2_OSC_Stream *stream, const int *dst,
+	unsigned ndst, LV2_OSC_Enum *ev)
+{
+	struct io_uring_sqe *last = NULL;
+
+	if(stream->uring.tx_cancel) // resubmit remainder of failed chain first
+	{
+		for(unsigned itx = 0; itx < LV2_OSC_STREAM_URING_DEPTH; itx++)
+		{
+			const uint64_t mask = UINT64_C(1) << itx;
+
+			if( (stream->uring.tx_cancel & mask)
+				&& _lv2_osc_stream_uring_send(stream, itx, &last) )
+			{
+				stream->uring.tx_cancel &= ~mask;
+			}
+		}
+	}
+	else
+	{
+		size_t tx_off = 0;
+		unsigned ntx = 0;
+		unsigned npkt = 0;
+
+		while( (ntx + ndst <= LV2_OSC_STREAM_URING_DEPTH - 1)
+			&& (_lv2_osc_stream_uring_space(stream) >= ndst) )
+		{
+			const uint8_t *buf;
+			size_t tosend;
+
+			if( !(buf = stream->driv->read_req(stream->data, &tosend)) )
+			{
+				break;
+			}
+
+			if(tx_off + tosend > sizeof(stream->tx_buf))
+			{
+				if(ntx > 0)
+				{
+					break; // flush batch first
+				}
+
+				// too large to be staged, send directly from ring
+				bool blocked;
+				const LV2_OSC_Enum ev1 = _lv2_osc_stream_send_udp_dests(stream, buf,
+					tosend, dst, ndst, &blocked);
+
+				if(blocked)
+				{
+					break;
+				}
+
+				*ev |= ev1;
+				if(ev1 & LV2_OSC_ERR)
+				{
+					break;
+				}
+
+				stream->driv->read_adv(stream->data);
+				continue;
+			}
+
+			uint8_t *buf_dst = stream->tx_buf + tx_off;
+			memcpy(buf_dst, buf, tosend);
+			stream->driv->read_adv(stream->data);
+
+			struct iovec *iov = &stream->uring.tx_iov[npkt++];
+
+			iov->iov_base = buf_dst;
+			iov->iov_len = tosend;
+
+			for(unsigned j = 0; j < ndst; j++)
+			{
+				LV2_OSC_Address *addr = &stream->uring.tx_name[ntx];
+				struct msghdr *msg = &stream->uring.tx_msg[ntx];
+
+				// copy, as the kernel reads it once the send is executed
+				*addr = *_lv2_osc_stream_peer_address(stream, dst[j]);
+
+				memset(msg, 0x0, sizeof(struct msghdr));
+				msg->msg_name = (void *)&addr->in6;
+				msg->msg_namelen = addr->len;
+				msg->msg_iov = iov;
+				msg->msg_iovlen = 1;
+
+				stream->uring.tx_peer[ntx] = dst[j];
+				_lv2_osc_stream_uring_send(stream, ntx++, &last);
+			}
+
+			tx_off += LV2_OSC_PADDED_SIZE(tosend);
+		}
+	}
+
+	if(last) // end of chain
+	{
+		last->flags &= ~IOSQE_IO_LINK;
+	}
+
+	return stream->uring.inflight;
+}
+
+static inline LV2_OSC_Enum
+_lv2_osc_stream_run_udp_uring(LV2_OSC_Stream *stream, time_t now,
+	const int *dst, unsigned ndst)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	while(true)
+	{
+		// (re)arm multishot receive into provided buffers, but only if the ring
+		// has space, datagrams stay in the socket otherwise
+		if(!stream->uring.armed && !stream->uring.held
+			&& stream->driv->write_req(stream->data, LV2_OSC_STREAM_REQBUF, NULL))
+		{
+			struct io_uring_sqe *sqe = _lv2_osc_stream_uring_sqe(stream);
+
+			if(sqe)
+			{
+				sqe->opcode = IORING_OP_RECVMSG;
+				sqe->fd = stream->sock;
+				sqe->addr = (uintptr_t)&stream->uring.rx_msg;
+				sqe->ioprio = IORING_RECV_MULTISHOT;
+				sqe->flags = IOSQE_BUFFER_SELECT;
+				sqe->buf_group = 0;
+				sqe->user_data = LV2_OSC_STREAM_URING_RECV;
+
+				stream->uring.armed = true;
+			}
+		}
+
+		// top up with another chain as soon as the previous one has completed
+		unsigned staged = 0;
+
+		if( (ndst || stream->uring.tx_cancel) && (stream->uring.inflight == 0) )
+		{
+			staged = _lv2_osc_stream_uring_stage(stream, dst, ndst, &ev);
+		}
+
+		// single syscall to submit everything and to flush pending completions
+		__atomic_store_n(stream->uring.sq_ktail, stream->uring.sq_tail,
+			__ATOMIC_RELEASE);
+
+		const int submitted = syscall(__NR_io_uring_enter, stream->uring.fd,
+			stream->uring.to_submit, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+
+		if(submitted >= 0)
+		{
+			stream->uring.to_submit -= submitted;
+		}
+		else if( (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY) )
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+		}
+
+		// reap completions
+		const uint16_t br_tail = stream->uring.br_tail;
+		unsigned head = *stream->uring.cq_khead;
+		const unsigned tail = __atomic_load_n(stream->uring.cq_ktail, __ATOMIC_ACQUIRE);
+
+		stream->uring.held = false;
+
+		for( ; head != tail; head++)
+		{
+			const struct io_uring_cqe *cqe = &stream->uring.cqes[head & *stream->uring.cq_kmask];
+
+			if(cqe->user_data == LV2_OSC_STREAM_URING_RECV)
+			{
+				if(!_lv2_osc_stream_uring_recv(stream, cqe, now, &ev))
+				{
+					stream->uring.held = true; // ring full, retry in next run
+					break;
+				}
+
+				continue;
+			}
+
+			const unsigned itx = cqe->user_data;
+			const struct msghdr *msg = &stream->uring.tx_msg[itx];
+
+			if(cqe->res == (int)msg->msg_iov->iov_len)
+			{
+				_lv2_osc_stream_peer_sent(stream, stream->uring.tx_peer[itx]);
+				ev |= LV2_OSC_SEND;
+			}
+			else if(cqe->res == -ECANCELED) // rest of chain after a failed send
+			{
+				stream->uring.tx_cancel |= UINT64_C(1) << itx;
+			}
+			else if(cqe->res >= 0)
 			{
-				ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
-				goto fail;
+				ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
+			}
+			else
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, -cqe->res);
 			}
 
-			ptr = tmp;
-			ptr[0] = '\0';
-			++ptr;
+			stream->uring.inflight -= 1;
 		}
 
-		// mandatory IPv4/6
-		ptr = strchr(ptr, ':');
-		if(!ptr)
+		__atomic_store_n(stream->uring.cq_khead, head, __ATOMIC_RELEASE);
+
+		if(stream->uring.br_tail != br_tail)
 		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, EDESTADDRREQ);
-			goto fail;
+			_lv2_osc_stream_uring_buf_publish(stream);
 		}
 
-		ptr[0] = '\0';
-
-		service = ++ptr;
-
-		if(strlen(node) == 0)
+		if(!staged || stream->uring.inflight || stream->uring.held)
 		{
-			node = NULL;
-			stream->server = true;
+			break; // nothing left to send or waiting for socket space
 		}
+	}
 
-		stream->sock = socket(stream->socket_family, stream->socket_type,
-			stream->protocol);
+	return ev;
+}
+#endif
 
-		if(stream->sock < 0)
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+static inline LV2_OSC_Enum
+_lv2_osc_stream_run_udp(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	const time_t now = _lv2_osc_stream_now();
 
-		if(fcntl(stream->sock, F_SETFL, O_NONBLOCK) == -1)
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+	_lv2_osc_stream_peer_expire(stream, now);
 
-		const int sendbuff = LV2_OSC_STREAM_SNDBUF;
-		const int recvbuff = LV2_OSC_STREAM_RCVBUF;
-		const int reuseaddr = 1;
+	// send everything
+	int dst [LV2_OSC_STREAM_PEERS];
+	const unsigned ndst = _lv2_osc_stream_peer_dests(stream, dst);
 
-		if(setsockopt(stream->sock, SOL_SOCKET,
-			SO_SNDBUF, &sendbuff, sizeof(sendbuff)) == -1)
-		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+#if LV2_OSC_STREAM_URING
+	if(stream->uring.fd >= 0)
+	{
+		return _lv2_osc_stream_run_udp_uring(stream, now, dst, ndst);
+	}
+#endif
 
-		if(setsockopt(stream->sock, SOL_SOCKET,
-			SO_RCVBUF, &recvbuff, sizeof(recvbuff)) == -1)
+	if(ndst) // has peers
+	{
+#if LV2_OSC_STREAM_MMSG
+		if(!stream->mmsg.tx_fallback)
 		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
+			ev |= _lv2_osc_stream_send_udp_mmsg(stream, dst, ndst);
 		}
-
-		if(setsockopt(stream->sock, SOL_SOCKET,
-			SO_REUSEADDR, &reuseaddr, sizeof(reuseaddr)) == -1)
+		else
+#endif
 		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-			goto fail;
-		}
+			const uint8_t *buf;
+			size_t tosend;
 
-		if(stream->socket_family == AF_INET) // IPv4
-		{
-			if(stream->server)
+			while( (buf = stream->driv->read_req(stream->data, &tosend)) )
 			{
-				// resolve self address
-				struct addrinfo hints;
-				memset(&hints, 0x0, sizeof(struct addrinfo));
-				hints.ai_family = stream->socket_family;
-				hints.ai_socktype = stream->socket_type;
-				hints.ai_protocol = stream->protocol;
+				bool blocked;
+				const LV2_OSC_Enum ev1 = _lv2_osc_stream_send_udp_dests(stream, buf,
+					tosend, dst, ndst, &blocked);
 
-				struct addrinfo *res;
-				if(getaddrinfo(node, service, &hints, &res) != 0)
+				if(blocked)
 				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
+					break;
 				}
-				if(res->ai_addrlen != sizeof(stream->peer.in4))
+
+				ev |= ev1;
+				if(ev1 & LV2_OSC_ERR)
 				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-					goto fail;
+					break;
 				}
 
-				stream->self.len = res->ai_addrlen;
-				memcpy(&stream->self.in4, res->ai_addr, res->ai_addrlen);
-				stream->self.in4.sin_addr.s_addr = htonl(INADDR_ANY);
+				stream->driv->read_adv(stream->data);
+			}
+		}
+	}
 
-				freeaddrinfo(res);
+	// recv everything
+#if LV2_OSC_STREAM_MMSG
+	if(stream->mmsg.rx_fallback || !_lv2_osc_stream_recv_udp_mmsg(stream, now, &ev))
+#endif
+	{
+		uint8_t *buf;
+		size_t max_len;
 
-				if(bind(stream->sock, (struct sockaddr *)&stream->self.in4,
-					stream->self.len) != 0)
+		while( (buf = stream->driv->write_req(stream->data,
+			LV2_OSC_STREAM_REQBUF, &max_len)) )
+		{
+			struct sockaddr_storage in;
+			socklen_t in_len = sizeof(in);
+
+			memset(&in, 0, in_len);
+			const ssize_t recvd = recvfrom(stream->sock, buf, max_len, 0,
+				(struct sockaddr *)&in, &in_len);
+
+			if(recvd == -1)
+			{
+				if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
 				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
+					// empty queue
+					break;
 				}
+
+				ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+				break;
 			}
-			else // client
+			else if(recvd == 0)
 			{
-				stream->self.len = sizeof(stream->self.in4);
-				stream->self.in4.sin_family = stream->socket_family;
-				stream->self.in4.sin_port = htons(0);
-				stream->self.in4.sin_addr.s_addr = htonl(INADDR_ANY);
+				// peer has shut down
+				break;
+			}
 
-				if(bind(stream->sock, (struct sockaddr *)&stream->self.in4,
-					stream->self.len) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+			_lv2_osc_stream_peer_touch(stream, &in, in_len, now);
 
-				// resolve peer address
-				struct addrinfo hints;
-				memset(&hints, 0x0, sizeof(struct addrinfo));
-				hints.ai_family = stream->socket_family;
-				hints.ai_socktype = stream->socket_type;
-				hints.ai_protocol = stream->protocol;
+			stream->driv->write_adv(stream->data, recvd);
+			ev |= LV2_OSC_RECV;
+		}
+	}
 
-				struct addrinfo *res;
-				if(getaddrinfo(node, service, &hints, &res) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
-				if(res->ai_addrlen != sizeof(stream->peer.in4))
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-					goto fail;
-				}
+	return ev;
+}
 
-				stream->peer.len = res->ai_addrlen;
-				memcpy(&stream->peer.in4, res->ai_addr, res->ai_addrlen);
+static inline LV2_OSC_Enum
+_lv2_osc_stream_setup_tcp(LV2_OSC_Stream *stream, int fd)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	const int flag = 1;
+	const int sendbuff = LV2_OSC_STREAM_SNDBUF;
+	const int recvbuff = LV2_OSC_STREAM_RCVBUF;
 
-				freeaddrinfo(res);
-			}
+	if(fcntl(fd, F_SETFL, O_NONBLOCK) == -1)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
 
-			if(stream->socket_type == SOCK_DGRAM)
-			{
-				const int broadcast = 1;
+	if(stream->socket_family != AF_UNIX)
+	{
+		if(setsockopt(fd, stream->protocol,
+			TCP_NODELAY, &flag, sizeof(flag)) != 0)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+		}
 
-				if(setsockopt(stream->sock, SOL_SOCKET, SO_BROADCAST,
-					&broadcast, sizeof(broadcast)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+		if(setsockopt(fd, SOL_SOCKET,
+			SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+		}
+	}
 
-				//FIXME handle multicast
-			}
-			else if(stream->socket_type == SOCK_STREAM)
-			{
-				const int flag = 1;
+	if(setsockopt(fd, SOL_SOCKET,
+		SO_SNDBUF, &sendbuff, sizeof(sendbuff)) == -1)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
 
-				if(setsockopt(stream->sock, stream->protocol,
-					TCP_NODELAY, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+	if(setsockopt(fd, SOL_SOCKET,
+		SO_RCVBUF, &recvbuff, sizeof(recvbuff)) == -1)
+	{
+		ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+	}
 
-				if(setsockopt(stream->sock, SOL_SOCKET,
-					SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+	return ev;
+}
 
-				if(stream->server)
-				{
-					if(listen(stream->sock, 1) != 0)
-					{
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						goto fail;
-					}
-				}
-				else // client
-				{
-					if(connect(stream->sock, (struct sockaddr *)&stream->peer.in4,
-						stream->peer.len) == 0)
-					{
-						stream->connected = true;
-					}
-				}
-			}
-			else
+static inline void
+_lv2_osc_stream_client_close(LV2_OSC_Stream *stream, unsigned idx)
+{
+	LV2_OSC_Client *client = &stream->clients[idx];
+
+	_close_socket(&client->fd);
+	_lv2_osc_rx_reset(&client->rx);
+	client->tx_off = 0;
+	client->stalled = 0;
+}
+
+// accept pending connections into unused client slots
+static inline LV2_OSC_Enum
+_lv2_osc_stream_accept_tcp(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	while(true)
+	{
+		LV2_OSC_Address addr;
+
+		addr.len = sizeof(addr.un);
+		const int fd = accept(stream->sock, (struct sockaddr *)&addr.un,
+			&addr.len);
+
+		if(fd < 0) // no pending connections
+		{
+			break;
+		}
+
+		LV2_OSC_Client *client = NULL;
+
+		for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+		{
+			if(stream->clients[i].fd < 0)
 			{
-				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-				goto fail;
+				client = &stream->clients[i];
+				break;
 			}
 		}
-		else if(stream->socket_family == AF_INET6) // IPv6
+
+		if(!client)
 		{
-			if(stream->server)
-			{
-				// resolve self address
-				struct addrinfo hints;
-				memset(&hints, 0x0, sizeof(struct addrinfo));
-				hints.ai_family = stream->socket_family;
-				hints.ai_socktype = stream->socket_type;
-				hints.ai_protocol = stream->protocol;
+			close(fd);
+			ev = LV2_OSC_STREAM_ERRNO(ev, EUSERS);
+			continue;
+		}
+
+		ev |= _lv2_osc_stream_setup_tcp(stream, fd);
+
+		client->fd = fd; // orderly accept
+		client->addr = addr;
+		_lv2_osc_rx_reset(&client->rx);
+		client->tx_off = 0; // starts with currently staged frames
+		client->stalled = 0;
+
+		// most recent client
+		stream->peer = addr;
+	}
 
-				struct addrinfo *res;
-				if(getaddrinfo(node, service, &hints, &res) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
-				if(res->ai_addrlen != sizeof(stream->peer.in6))
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-					goto fail;
-				}
+	return ev;
+}
 
-				stream->self.len = res->ai_addrlen;
-				memcpy(&stream->self.in6, res->ai_addr, res->ai_addrlen);
-				stream->self.in6.sin6_addr = in6addr_any;
-				if(iface)
-				{
-					stream->self.in6.sin6_scope_id = if_nametoindex(iface);
-				}
+// append frame of packet to the ones staged in tx_buf, returns 0 if it does
+// not fit
+static inline size_t
+_lv2_osc_stream_frame(LV2_OSC_Stream *stream, const uint8_t *buf,
+	size_t tosend)
+{
+	uint8_t *dst = stream->tx_buf + stream->tx_len;
+	const size_t max = sizeof(stream->tx_buf) - stream->tx_len;
 
-				freeaddrinfo(res);
+	if(stream->slip) // SLIP framed
+	{
+		// encode straight into tx_buf, fails if escaping would exceed it
+		tosend = lv2_osc_slip_encode(dst, max, buf, tosend);
+	}
+	else // uint32_t prefix frames
+	{
+		const size_t nsize = tosend + sizeof(uint32_t);
 
-				if(bind(stream->sock, (struct sockaddr *)&stream->self.in6,
-					stream->self.len) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
-			}
-			else // client
-			{
-				stream->self.len = sizeof(stream->self.in6);
-				stream->self.in6.sin6_family = stream->socket_family;
-				stream->self.in6.sin6_port = htons(0);
-				stream->self.in6.sin6_addr = in6addr_any;
-				if(iface)
-				{
-					stream->self.in6.sin6_scope_id = if_nametoindex(iface);
-				}
+		if(nsize <= max) // check if there is enough memory
+		{
+			const uint32_t prefix = htonl(tosend);
 
-				if(bind(stream->sock, (struct sockaddr *)&stream->self.in6,
-					stream->self.len) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+			memcpy(dst, &prefix, sizeof(uint32_t));
+			memcpy(dst + sizeof(uint32_t), buf, tosend);
+			tosend = nsize;
+		}
+		else
+		{
+			tosend = 0;
+		}
+	}
 
-				// resolve peer address
-				struct addrinfo hints;
-				memset(&hints, 0x0, sizeof(struct addrinfo));
-				hints.ai_family = stream->socket_family;
-				hints.ai_socktype = stream->socket_type;
-				hints.ai_protocol = stream->protocol;
+	stream->tx_len += tosend;
 
-				struct addrinfo *res;
-				if(getaddrinfo(node, service, &hints, &res) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
-				if(res->ai_addrlen != sizeof(stream->peer.in6))
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-					goto fail;
-				}
+	return tosend;
+}
 
-				stream->peer.len = res->ai_addrlen;
-				memcpy(&stream->peer.in6, res->ai_addr, res->ai_addrlen);
+// release packets of staged frames once written and stage frames of as many
+// queued packets as fit into tx_buf, to be written with a single call,
+// oversized packets are written in parts, returns false if there are none
+static inline bool
+_lv2_osc_stream_stage(LV2_OSC_Stream *stream)
+{
+	const uint8_t *buf;
+	size_t tosend;
 
-				if(iface)
-				{
-					stream->peer.in6.sin6_scope_id = if_nametoindex(iface);
-				}
+	for( ; stream->tx_cnt; stream->tx_cnt--)
+	{
+		stream->driv->read_adv(stream->data);
+	}
 
-				freeaddrinfo(res);
-			}
+	stream->tx_off = 0;
+	stream->tx_len = 0;
+	stream->tx_ext = 0;
 
-			if(stream->socket_type == SOCK_DGRAM)
+	buf = stream->driv->read_req(stream->data, &tosend);
+
+	while(buf)
+	{
+		if(tosend == 0) // nothing to send, released in order
+		{
+			if(stream->tx_cnt)
 			{
-				// nothing to do
+				break;
 			}
-			else if(stream->socket_type == SOCK_STREAM)
-			{
-				const int flag = 1;
 
-				if(setsockopt(stream->sock, stream->protocol,
-					TCP_NODELAY, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+			stream->driv->read_adv(stream->data);
+			buf = stream->driv->read_req(stream->data, &tosend);
+			continue;
+		}
 
-				if(setsockopt(stream->sock, SOL_SOCKET,
-					SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					goto fail;
-				}
+		if(!stream->tx_part && _lv2_osc_stream_frame(stream, buf, tosend))
+		{
+			stream->tx_cnt += 1;
+			buf = stream->driv->read_next
+				? stream->driv->read_next(stream->data, &tosend)
+				: NULL;
+			continue;
+		}
 
-				if(stream->server)
-				{
-					if(listen(stream->sock, 1) != 0)
-					{
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						goto fail;
-					}
-				}
-				else // client
-				{
-					if(connect(stream->sock, (struct sockaddr *)&stream->peer.in6,
-						stream->peer.len) == 0)
-					{
-						stream->connected = true;
-					}
-				}
+		if(stream->tx_len)
+		{
+			break; // goes into next batch
+		}
+
+		if(stream->slip) // encode oversized packet in parts of tx_buf
+		{
+			size_t len = 0;
+			size_t consumed;
+
+			if(stream->tx_part == 0)
+			{
+				stream->tx_buf[len++] = SLIP_END;
 			}
-			else
+
+			len += lv2_osc_slip_encode_part(stream->tx_buf + len,
+				sizeof(stream->tx_buf) - len - 1, buf + stream->tx_part,
+				tosend - stream->tx_part, &consumed);
+			stream->tx_part += consumed;
+
+			if(stream->tx_part == tosend)
 			{
-				ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-				goto fail;
+				stream->tx_buf[len++] = SLIP_END;
+				stream->tx_part = 0;
+				stream->tx_cnt = 1;
 			}
+
+			stream->tx_len = len;
 		}
-		else
+		else // stage prefix only, oversized packet is written from the ring
 		{
-			ev = LV2_OSC_STREAM_ERRNO(ev, EPROTOTYPE);
-			goto fail;
+			const uint32_t prefix = htonl(tosend);
+
+			memcpy(stream->tx_buf, &prefix, sizeof(uint32_t));
+			stream->tx_len = sizeof(uint32_t);
+			stream->tx_ext = tosend;
+			stream->tx_cnt = 1;
 		}
-	}
 
-	free(dup);
+		break;
+	}
 
-	return ev;
+	return stream->tx_len || stream->tx_cnt;
+}
 
-fail:
-	if(dup)
+// release packets of staged frames with read_adv before they are written, e.g.
+// to free their ring space for others, these are not staged again after
+// reconnecting, an oversized packet written from the ring or in parts is kept
+static inline void
+lv2_osc_stream_release(LV2_OSC_Stream *stream)
+{
+	if(stream->tx_ext)
 	{
-		free(dup);
+		return;
 	}
 
-	_close_socket(&stream->sock);
+	for( ; stream->tx_cnt; stream->tx_cnt--)
+	{
+		stream->driv->read_adv(stream->data);
+	}
+}
 
-	return ev;
+// packets at the head of the ring referenced by staged frames, these must be
+// left alone until the stream releases them with read_adv
+static inline size_t
+lv2_osc_stream_staged(const LV2_OSC_Stream *stream)
+{
+	return stream->tx_part ? 1 : stream->tx_cnt;
 }
 
-static inline int
-lv2_osc_stream_init(LV2_OSC_Stream *stream, const char *url,
-	const LV2_OSC_Driver *driv, void *data)
+// write staged frames from *tx_off on, continues partial writes until the
+// descriptor would block
+static inline LV2_OSC_Enum
+_lv2_osc_stream_flush(LV2_OSC_Stream *stream, int fd, size_t *tx_off,
+	bool *blocked)
 {
-	memset(stream, 0x0, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	const uint8_t *ext = NULL;
 
-	strncpy(stream->url, url, sizeof(stream->url) - 1);
-	stream->driv = driv;
-	stream->data = data;
-	stream->sock = -1;
-	stream->fd = -1;
+	*blocked = false;
 
-	return _lv2_osc_stream_reinit(stream);
-}
+	if(stream->tx_ext)
+	{
+		size_t len;
 
-#define SLIP_END					0300	// 0xC0, 192, indicates end of packet
-#define SLIP_ESC					0333	// 0xDB, 219, indicates byte stuffing
-#define SLIP_END_REPLACE	0334	// 0xDC, 220, ESC ESC_END means END data byte
-#define SLIP_ESC_REPLACE	0335	// 0xDD, 221, ESC ESC_ESC means ESC data byte
+		// the ring may have moved the packet since it was staged
+		ext = stream->driv->read_req(stream->data, &len);
 
-// SLIP encoding
-static inline size_t
-lv2_osc_slip_encode_inline(uint8_t *dst, size_t len)
-{
-	if(len == 0)
-		return 0;
+		if(!ext || (len != stream->tx_ext) )
+		{
+			stream->tx_len = 0;
+			stream->tx_ext = 0;
+			stream->tx_cnt = 0;
+			return LV2_OSC_STREAM_ERRNO(ev, EIO);
+		}
+	}
 
-	const uint8_t *end = dst + len;
+	const size_t total = stream->tx_len + stream->tx_ext;
 
-	// estimate new size
-	size_t size = 2; // double ended SLIP
-	for(const uint8_t *from=dst; from<end; from++, size++)
+	while(*tx_off < total)
 	{
-		if( (*from == SLIP_END) || (*from == SLIP_ESC))
-			size ++;
+		struct iovec iov [2];
+		int iovcnt = 0;
+
+		if(*tx_off < stream->tx_len)
+		{
+			iov[iovcnt].iov_base = stream->tx_buf + *tx_off;
+			iov[iovcnt++].iov_len = stream->tx_len - *tx_off;
+		}
+
+		if(ext)
+		{
+			const size_t ext_off = (*tx_off > stream->tx_len)
+				? *tx_off - stream->tx_len
+				: 0;
+
+			iov[iovcnt].iov_base = (void *)(ext + ext_off);
+			iov[iovcnt++].iov_len = stream->tx_ext - ext_off;
+		}
+
+		const ssize_t sent = writev(fd, iov, iovcnt);
+
+		if(sent == -1)
+		{
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+			{
+				// full queue
+				*blocked = true;
+				break;
+			}
+			else if(errno == EINTR)
+			{
+				continue;
+			}
+
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			break;
+		}
+
+		*tx_off += sent;
+		ev |= LV2_OSC_SEND;
 	}
 
-	// fast track if no escaping needed
-	if(size == len + 2)
+	return ev;
+}
+
+// largest received packet the ring can ever take, frames exceeding it are
+// skipped instead of waiting for room forever
+static inline size_t
+_lv2_osc_stream_packet_max(LV2_OSC_Stream *stream)
+{
+	const size_t max = LV2_OSC_STREAM_FRAME_MAX - sizeof(uint32_t);
+
+	if(stream->driv->write_max)
 	{
-		memmove(dst+1, dst, len);
-		dst[0] = SLIP_END;
-		dst[size-1] = SLIP_END;
+		const size_t ring = stream->driv->write_max(stream->data);
 
-		return size;
+		return (ring < max) ? ring : max;
 	}
 
-	// slow track if some escaping needed
-	uint8_t *to = dst + size - 1;
-	*to-- = SLIP_END;
-	for(const uint8_t *from=end-1; from>=dst; from--)
+	return max;
+}
+
+// dispatch all complete uint32_t prefix frames assembled in rx and keep
+// the partial rest at its start, frames which can never fit are skipped, sets
+// full if the ring has no room for the next one
+static inline LV2_OSC_Enum
+_lv2_osc_stream_unframe_prefix(LV2_OSC_Stream *stream, LV2_OSC_Rx *rx,
+	bool *full)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	uint8_t *rx_buf = _lv2_osc_rx_buf(rx);
+	const size_t max = _lv2_osc_stream_packet_max(stream);
+	size_t off = 0;
+	size_t need = 0; // of partial frame at start
+
+	while(true)
 	{
-		if(*from == SLIP_END)
+		const size_t avail = rx->off - off;
+
+		if(rx->skip)
 		{
-			*to-- = SLIP_END_REPLACE;
-			*to-- = SLIP_ESC;
+			const size_t skipped = (rx->skip < avail) ? rx->skip : avail;
+
+			off += skipped;
+			rx->skip -= skipped;
+
+			if(rx->skip)
+			{
+				break;
+			}
+
+			continue;
 		}
-		else if(*from == SLIP_ESC)
+
+		if(avail < sizeof(uint32_t))
 		{
-			*to-- = SLIP_ESC_REPLACE;
-			*to-- = SLIP_ESC;
+			break;
+		}
+
+		uint32_t prefix;
+		memcpy(&prefix, rx_buf + off, sizeof(uint32_t));
+		prefix = ntohl(prefix);
+
+		if(prefix > max)
+		{
+			off += sizeof(uint32_t);
+			rx->skip = prefix;
+			ev = LV2_OSC_STREAM_ERRNO(ev, EMSGSIZE);
+			continue;
+		}
+
+		if(avail < sizeof(uint32_t) + prefix) // wait for rest of frame
+		{
+			need = sizeof(uint32_t) + prefix;
+			break;
+		}
+
+		uint8_t *buf;
+
+		if( !(buf = stream->driv->write_req(stream->data, prefix, NULL)) )
+		{
+			*full = true; // retry once drained
+			break;
+		}
+
+		memcpy(buf, rx_buf + off + sizeof(uint32_t), prefix);
+		stream->driv->write_adv(stream->data, prefix);
+		ev |= LV2_OSC_RECV;
+
+		off += sizeof(uint32_t) + prefix;
+	}
+
+	if(off)
+	{
+		memmove(rx_buf, rx_buf + off, rx->off - off);
+		rx->off -= off;
+	}
+
+	if(need > _lv2_osc_rx_size(rx))
+	{
+		if(!_lv2_osc_rx_grow(rx, need, sizeof(uint32_t) + max))
+		{
+			// skip frame, as there is no memory to assemble it
+			rx->skip = need - rx->off;
+			rx->off = 0;
+			ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
 		}
-		else
-			*to-- = *from;
 	}
-	*to-- = SLIP_END;
+	else if(need <= sizeof(rx->buf))
+	{
+		_lv2_osc_rx_trim(rx);
+	}
 
-	return size;
+	return ev;
 }
 
-// SLIP decoding
-static inline size_t 
-lv2_osc_slip_decode_inline(uint8_t *dst, size_t len, size_t *size)
+// dispatch all complete SLIP frames assembled in rx, decoded straight into
+// the ring, and keep the partial rest at its start, sets full if the ring has
+// no room for the next one
+static inline LV2_OSC_Enum
+_lv2_osc_stream_unframe_slip(LV2_OSC_Stream *stream, LV2_OSC_Rx *rx,
+	bool *full)
 {
-	const uint8_t *src = dst;
-	const uint8_t *end = dst + len;
-	uint8_t *ptr = dst;
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	uint8_t *rx_buf = _lv2_osc_rx_buf(rx);
+	const size_t max = _lv2_osc_stream_packet_max(stream);
+	size_t off = 0;
+	bool partial = false;
 
-	bool whole = false;
+	// escaping at most doubles size of encoded frames
+	const size_t frame_max = (max < (LV2_OSC_STREAM_FRAME_MAX - 2) / 2)
+		? 2*max + 2
+		: LV2_OSC_STREAM_FRAME_MAX;
 
-	if( (src < end) && (*src == SLIP_END) )
+	if(rx->skip) // rest of a frame exceeding frame_max
 	{
-		 whole = true;
-		 src++;
+		const uint8_t *stop = memchr(rx_buf, SLIP_END, rx->off);
+
+		if(!stop)
+		{
+			rx->off = 0;
+			return ev;
+		}
+
+		off = stop - rx_buf + 1;
+		rx->skip = 0;
 	}
 
-	while(src < end)
+	while(off < rx->off)
 	{
-		if(*src == SLIP_ESC)
+		const uint8_t *src = rx_buf + off;
+		const size_t avail = rx->off - off;
+
+		// complete frames end with END, not counting a leading one
+		const uint8_t *stop = (avail > 1)
+			? memchr(src + 1, SLIP_END, avail - 1)
+			: NULL;
+
+		if(!stop)
 		{
-			if(src == end-1)
-				break;
+			partial = true;
+			break;
+		}
 
-			src++;
-			if(*src == SLIP_END_REPLACE)
-				*ptr++ = SLIP_END;
-			else if(*src == SLIP_ESC_REPLACE)
-				*ptr++ = SLIP_ESC;
-			src++;
+		const size_t len = stop - src + 1;
+		uint8_t *buf;
+		size_t size = len; // decoded frame never exceeds encoded one
+
+		if(size > max)
+		{
+			size = _lv2_osc_slip_decoded_max(src, len);
+
+			if(size > max) // can never fit into ring
+			{
+				off += len;
+				ev = LV2_OSC_STREAM_ERRNO(ev, EMSGSIZE);
+				continue;
+			}
 		}
-		else if(*src == SLIP_END)
+
+		if( !(buf = stream->driv->write_req(stream->data, size, NULL)) )
 		{
-			src++;
+			*full = true; // retry once drained
+			break;
+		}
 
-			*size = whole ? ptr - dst : 0;
-			return src - dst;
+		lv2_osc_slip_decode(buf, src, len, &size);
+
+		if(size) // dispatch
+		{
+			stream->driv->write_adv(stream->data, size);
+			ev |= LV2_OSC_RECV;
 		}
-		else
+
+		off += len;
+	}
+
+	if(off)
+	{
+		memmove(rx_buf, rx_buf + off, rx->off - off);
+		rx->off -= off;
+	}
+
+	const size_t rx_size = _lv2_osc_rx_size(rx);
+
+	if(partial && (rx->off == rx_size) ) // fills whole buffer
+	{
+		if(rx_size >= frame_max)
+		{
+			// skip until END of frame
+			rx->off = 0;
+			rx->skip = 1;
+			ev = LV2_OSC_STREAM_ERRNO(ev, EMSGSIZE);
+		}
+		else if(!_lv2_osc_rx_grow(rx,
+			(rx_size << 1 < frame_max) ? rx_size << 1 : frame_max, frame_max))
 		{
-			*ptr++ = *src++;
+			rx->off = 0;
+			rx->skip = 1;
+			ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
 		}
 	}
+	else
+	{
+		_lv2_osc_rx_trim(rx);
+	}
 
-	*size = 0;
-	return 0;
+	return ev;
 }
 
+// receive and dispatch frames of a TCP connection or serial device, sets closed
+// upon failure or shutdown
 static inline LV2_OSC_Enum
-_lv2_osc_stream_run_udp(LV2_OSC_Stream *stream)
+_lv2_osc_stream_recv_frames(LV2_OSC_Stream *stream, int fd, LV2_OSC_Rx *rx,
+	bool *closed)
 {
 	LV2_OSC_Enum ev = LV2_OSC_NONE;
 
-	// send everything
-	if(stream->peer.len) // has a peer
+	*closed = false;
+
+	while(true)
 	{
-		const uint8_t *buf;
-		size_t tosend;
+		bool full = false;
 
-		while( (buf = stream->driv->read_req(stream->data, &tosend)) )
+		// frames left over from last call first
+		ev |= stream->slip
+			? _lv2_osc_stream_unframe_slip(stream, rx, &full)
+			: _lv2_osc_stream_unframe_prefix(stream, rx, &full);
+
+		if(full) // leave rest in socket until ring is drained
 		{
-			const ssize_t sent = sendto(stream->sock, buf, tosend, 0,
-				(struct sockaddr *)&stream->peer.in6, stream->peer.len);
+			break;
+		}
 
-			if(sent == -1)
-			{
-				if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-				{
-					// full queue
-					break;
-				}
+		uint8_t *rx_buf = _lv2_osc_rx_buf(rx);
+		const size_t rx_size = _lv2_osc_rx_size(rx);
+		const ssize_t recvd = stream->serial
+			? read(fd, rx_buf + rx->off, rx_size - rx->off)
+			: recv(fd, rx_buf + rx->off, rx_size - rx->off, 0);
 
-				ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				break;
-			}
-			else if(sent != (ssize_t)tosend)
+		if(recvd == -1)
+		{
+			if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
 			{
-				ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
+				// empty queue
 				break;
 			}
 
-			stream->driv->read_adv(stream->data);
-			ev |= LV2_OSC_SEND;
+			*closed = true;
+			ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+			break;
 		}
-	}
-
-	// recv everything
-	{
-		uint8_t *buf;
-		size_t max_len;
-
-		while( (buf = stream->driv->write_req(stream->data,
-			LV2_OSC_STREAM_REQBUF, &max_len)) )
+		else if(recvd == 0)
 		{
-			struct sockaddr_in6 in;
-			socklen_t in_len = sizeof(in);
-
-			memset(&in, 0, in_len);
-			const ssize_t recvd = recvfrom(stream->sock, buf, max_len, 0,
-				(struct sockaddr *)&in, &in_len);
-
-			if(recvd == -1)
-			{
-				if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-				{
-					// empty queue
-					break;
-				}
-
-				ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				break;
-			}
-			else if(recvd == 0)
+			if(!stream->serial)
 			{
-				// peer has shut down
-				break;
+				*closed = true; // orderly shutdown
 			}
+			break;
+		}
 
-			stream->peer.len = in_len;
-			memcpy(&stream->peer.in6, &in, in_len);
+		rx->off += recvd;
+	}
 
-			stream->driv->write_adv(stream->data, recvd);
-			ev |= LV2_OSC_RECV;
-		}
+	return ev;
+}
+
+// receive frames of a single connection, closes socket on failure or shutdown
+static inline LV2_OSC_Enum
+_lv2_osc_stream_recv_tcp(LV2_OSC_Stream *stream, int *fd, LV2_OSC_Rx *rx)
+{
+	bool closed;
+	const LV2_OSC_Enum ev = _lv2_osc_stream_recv_frames(stream, *fd, rx,
+		&closed);
+
+	if(closed)
+	{
+		_close_socket(fd);
+		_lv2_osc_rx_reset(rx);
 	}
 
 	return ev;
 }
 
 static inline LV2_OSC_Enum
-_lv2_osc_stream_run_tcp(LV2_OSC_Stream *stream)
+_lv2_osc_stream_run_tcp_server(LV2_OSC_Stream *stream)
 {
 	LV2_OSC_Enum ev = LV2_OSC_NONE;
 
 	// handle connections
-	if(!stream->connected) // no peer
+	ev |= _lv2_osc_stream_accept_tcp(stream);
+
+	stream->connected = false;
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+	{
+		if(stream->clients[i].fd >= 0)
+		{
+			stream->connected = true;
+			break;
+		}
+	}
+
+	// broadcast everything, staged frames are released once all clients got them
+	while(stream->connected)
 	{
-		if(stream->server)
+		bool pending = false;
+
+		for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
 		{
-			stream->peer.len = sizeof(stream->peer.in6);
-			stream->fd = accept(stream->sock, (struct sockaddr *)&stream->peer.in6,
-				&stream->peer.len);
+			const LV2_OSC_Client *client = &stream->clients[i];
 
-			if(stream->fd >= 0)
+			if( (client->fd >= 0)
+				&& (client->tx_off < stream->tx_len + stream->tx_ext) )
 			{
-				const int flag = 1;
-				const int sendbuff = LV2_OSC_STREAM_SNDBUF;
-				const int recvbuff = LV2_OSC_STREAM_RCVBUF;
+				pending = true;
+				break;
+			}
+		}
 
-				if(fcntl(stream->fd, F_SETFL, O_NONBLOCK) == -1)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				}
+		if(!pending)
+		{
+			for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+			{
+				stream->clients[i].tx_off = 0;
+			}
 
-				if(setsockopt(stream->fd, stream->protocol,
-					TCP_NODELAY, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				}
+			if(!_lv2_osc_stream_stage(stream))
+			{
+				break;
+			}
+		}
 
-				if(setsockopt(stream->sock, SOL_SOCKET,
-					SO_KEEPALIVE, &flag, sizeof(flag)) != 0)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				}
+		uint32_t blocked = 0;
+		bool waiting = false;
 
-				if(setsockopt(stream->fd, SOL_SOCKET,
-					SO_SNDBUF, &sendbuff, sizeof(sendbuff)) == -1)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				}
+		for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+		{
+			LV2_OSC_Client *client = &stream->clients[i];
 
-				if(setsockopt(stream->fd, SOL_SOCKET,
-					SO_RCVBUF, &recvbuff, sizeof(recvbuff)) == -1)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-				}
+			if(client->fd < 0)
+			{
+				continue;
+			}
+
+			bool full;
+			const LV2_OSC_Enum ev1 = _lv2_osc_stream_flush(stream, client->fd,
+				&client->tx_off, &full);
+
+			ev |= ev1;
+			if(ev1 & LV2_OSC_ERR)
+			{
+				// partially sent frames corrupt the stream, drop client
+				_lv2_osc_stream_client_close(stream, i);
+				continue;
+			}
 
-				stream->connected = true; // orderly accept
+			if(full)
+			{
+				blocked |= 1U << i; // continue with this client next call
 			}
 			else
 			{
-				//ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+				client->stalled = 0;
+				waiting = true;
 			}
 		}
-		else
+
+		if(!blocked)
+		{
+			continue;
+		}
+
+		// a single slow client must not hold back the others indefinitely
+		const int64_t now = _lv2_osc_stream_now_ms();
+
+		for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
 		{
-			if(stream->sock < 0)
+			LV2_OSC_Client *client = &stream->clients[i];
+
+			if( !(blocked & (1U << i)) )
 			{
-				ev = _lv2_osc_stream_reinit(stream);
+				continue;
 			}
 
-			if(connect(stream->sock, (struct sockaddr *)&stream->peer.in6,
-				stream->peer.len) == 0)
+			if(!waiting)
 			{
-				stream->connected = true; // orderly (re)connect
+				client->stalled = 0;
 			}
-			else
+			else if(client->stalled == 0)
 			{
-				//if(errno == EISCONN)
-				//{
-				//	_close_socket(&stream->sock);
-				//}
-
-				//ev = LV2_OSC_STREAM_ERRNO(ev, errno);
+				client->stalled = now;
+			}
+			else if(now - client->stalled >= LV2_OSC_STREAM_STALL_TIMEOUT)
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, ETIMEDOUT);
+				_lv2_osc_stream_client_close(stream, i);
+				blocked &= ~(1U << i);
 			}
 		}
+
+		if(blocked)
+		{
+			break;
+		}
 	}
 
-	// send everything
-	if(stream->connected)
+	// recv everything
+	stream->connected = false;
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
 	{
-		int *fd = stream->server
-			? &stream->fd
-			: &stream->sock;
+		LV2_OSC_Client *client = &stream->clients[i];
 
-		if(*fd >= 0)
+		if(client->fd < 0)
 		{
-			const uint8_t *buf;
-			size_t tosend;
+			continue;
+		}
 
-			while( (buf = stream->driv->read_req(stream->data, &tosend)) )
-			{
-				if(stream->slip) // SLIP framed
-				{
-					if(tosend <= sizeof(stream->tx_buf)) // check if there is enough memory
-					{
-						memcpy(stream->tx_buf, buf, tosend);
-						tosend = lv2_osc_slip_encode_inline(stream->tx_buf, tosend);
-					}
-					else
-					{
-						tosend = 0;
-					}
-				}
-				else // uint32_t prefix frames
-				{
-					const size_t nsize = tosend + sizeof(uint32_t);
+		ev |= _lv2_osc_stream_recv_tcp(stream, &client->fd, &client->rx);
 
-					if(nsize <= sizeof(stream->tx_buf)) // check if there is enough memory
-					{
-						const uint32_t prefix = htonl(tosend);
+		if(client->fd < 0)
+		{
+			_lv2_osc_stream_client_close(stream, i);
+			continue;
+		}
 
-						memcpy(stream->tx_buf, &prefix, sizeof(uint32_t));
-						memcpy(stream->tx_buf + sizeof(uint32_t), buf, tosend);
-						tosend = nsize;
-					}
-					else
-					{
-						tosend = 0;
-					}
-				}
+		stream->connected = true;
+	}
 
-				const ssize_t sent = tosend
-					? send(*fd, stream->tx_buf, tosend, 0)
-					: 0;
+	if(stream->connected)
+	{
+		ev |= LV2_OSC_CONN;
+	}
 
-				if(sent == -1)
-				{
-					if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-					{
-						// empty queue
-						break;
-					}
+	return ev;
+}
 
-					_close_socket(fd);
-					stream->connected = false;
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					break;
-				}
-				else if(sent != (ssize_t)tosend)
-				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
-					break;
-				}
+static inline LV2_OSC_Enum
+_lv2_osc_stream_run_tcp(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
 
-				stream->driv->read_adv(stream->data);
-				ev |= LV2_OSC_SEND;
-			}
-		}
+	if(stream->server)
+	{
+		return _lv2_osc_stream_run_tcp_server(stream);
 	}
 
-	// recv everything
-	if(stream->connected)
+	// complete pending connect without blocking
+	if(stream->conn.pending)
 	{
-		int *fd = stream->server
-			? &stream->fd
-			: &stream->sock;
+		struct pollfd fds = {
+			.fd = stream->sock,
+			.events = POLLOUT,
+			.revents = 0
+		};
 
-		if(*fd >= 0)
+		if(poll(&fds, 1, 0) == 1)
 		{
-			if(stream->slip) // SLIP framed
+			int err = 0;
+			socklen_t len = sizeof(err);
+
+			stream->conn.pending = false;
+
+			if(getsockopt(stream->sock, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
 			{
-				while(true)
-				{
-					ssize_t recvd = recv(*fd, stream->rx_buf + stream->rx_off,
-						sizeof(stream->rx_buf) - stream->rx_off, 0);
+				err = errno;
+			}
 
-					if(recvd == -1)
-					{
-						if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-						{
-							// empty queue
-							break;
-						}
-
-						_close_socket(fd);
-						stream->connected = false;
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						break;
-					}
-					else if(recvd == 0)
-					{
-						_close_socket(fd);
-						stream->connected = false; // orderly shutdown
-						break;
-					}
+			if(err == 0)
+			{
+				stream->connected = true;
+				stream->conn.backoff = 0;
+			}
+			else
+			{
+				ev = LV2_OSC_STREAM_ERRNO(ev, err);
+				_close_socket(&stream->sock);
+				_lv2_osc_stream_backoff(stream);
+			}
+		}
+		else if(_lv2_osc_stream_now_ms() - stream->conn.since
+			>= LV2_OSC_STREAM_CONNECT_TIMEOUT)
+		{
+			ev = LV2_OSC_STREAM_ERRNO(ev, ETIMEDOUT);
+			_close_socket(&stream->sock);
+			_lv2_osc_stream_backoff(stream);
+		}
+	}
 
-					uint8_t *ptr = stream->rx_buf;
-					recvd += stream->rx_off;
+	// send everything, in batches of staged frames
+	while(stream->connected && (stream->sock >= 0) )
+	{
+		if( (stream->tx_off == stream->tx_len + stream->tx_ext)
+			&& !_lv2_osc_stream_stage(stream) )
+		{
+			break;
+		}
 
-					while(recvd > 0)
-					{
-						size_t size;
-						size_t parsed = lv2_osc_slip_decode_inline(ptr, recvd, &size);
-
-						if(size) // dispatch
-						{
-							uint8_t *buf;
-
-							if( (buf = stream->driv->write_req(stream->data, size, NULL)) )
-							{
-								memcpy(buf, ptr, size);
-
-								stream->driv->write_adv(stream->data, size);
-								ev |= LV2_OSC_RECV;
-							}
-							else
-							{
-								parsed = 0;
-								ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
-							}
-						}
-
-						if(parsed)
-						{
-							ptr += parsed;
-							recvd -= parsed;
-						}
-						else
-						{
-							break;
-						}
-					}
+		bool blocked;
+		const LV2_OSC_Enum ev1 = _lv2_osc_stream_flush(stream, stream->sock,
+			&stream->tx_off, &blocked);
 
-					if(recvd > 0) // is there remaining chunk for next call?
-					{
-						memmove(stream->rx_buf, ptr, recvd);
-						stream->rx_off = recvd;
-					}
-					else
-					{
-						stream->rx_off = 0;
-					}
+		ev |= ev1;
+		if(ev1 & LV2_OSC_ERR)
+		{
+			// staged again for next connection
+			_lv2_osc_stream_unstage(stream, stream->tx_off);
+			_close_socket(&stream->sock);
+			stream->connected = false;
+			break;
+		}
 
-					break;
-				}
-			}
-			else // uint32_t prefix frames
-			{
-				uint8_t *buf;
-				
-				while( (buf = stream->driv->write_req(stream->data,
-					LV2_OSC_STREAM_REQBUF, NULL)) )
-				{
-					uint32_t prefix;
+		if(blocked)
+		{
+			break;
+		}
+	}
 
-					ssize_t recvd = recv(*fd, &prefix, sizeof(uint32_t), 0);
-					if(recvd == sizeof(uint32_t))
-					{
-						prefix = ntohl(prefix); //FIXME check prefix <= max_len
-						recvd = recv(*fd, buf, prefix, 0);
-					}
-					else if(recvd == -1)
-					{
-						if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-						{
-							// empty queue
-							break;
-						}
-
-						_close_socket(fd);
-						stream->connected = false;
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						break;
-					}
-					else if(recvd == 0)
-					{
-						_close_socket(fd);
-						stream->connected = false; // orderly shutdown
-						break;
-					}
+	// recv everything
+	if(stream->connected && (stream->sock >= 0) )
+	{
+		ev |= _lv2_osc_stream_recv_tcp(stream, &stream->sock, &stream->rx);
 
-					stream->driv->write_adv(stream->data, recvd);
-					ev |= LV2_OSC_RECV;
-				}
-			}
+		if(stream->sock < 0)
+		{
+			stream->connected = false;
 		}
 	}
 
@@ -1159,64 +4562,24 @@ _lv2_osc_stream_run_ser(LV2_OSC_Stream *stream)
 
 		if(fd >= 0)
 		{
-			const uint8_t *buf;
-			size_t tosend;
-
-			while( (buf = stream->driv->read_req(stream->data, &tosend)) )
+			// in batches of staged frames, partial writes continue next call
+			while(true)
 			{
-				if(stream->slip) // SLIP framed
-				{
-					if(tosend <= sizeof(stream->tx_buf)) // check if there is enough memory
-					{
-						memcpy(stream->tx_buf, buf, tosend);
-						tosend = lv2_osc_slip_encode_inline(stream->tx_buf, tosend);
-					}
-					else
-					{
-						tosend = 0;
-					}
-				}
-				else // uint32_t prefix frames
+				if( (stream->tx_off == stream->tx_len + stream->tx_ext)
+					&& !_lv2_osc_stream_stage(stream) )
 				{
-					const size_t nsize = tosend + sizeof(uint32_t);
-
-					if(nsize <= sizeof(stream->tx_buf)) // check if there is enough memory
-					{
-						const uint32_t prefix = htonl(tosend);
-
-						memcpy(stream->tx_buf, &prefix, sizeof(uint32_t));
-						memcpy(stream->tx_buf + sizeof(uint32_t), buf, tosend);
-						tosend = nsize;
-					}
-					else
-					{
-						tosend = 0;
-					}
+					break;
 				}
 
-				const ssize_t sent = tosend
-					? write(fd, stream->tx_buf, tosend)
-					: 0;
-
-				if(sent == -1)
-				{
-					if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-					{
-						// empty queue
-						break;
-					}
+				bool blocked;
+				const LV2_OSC_Enum ev1 = _lv2_osc_stream_flush(stream, fd,
+					&stream->tx_off, &blocked);
 
-					ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-					break;
-				}
-				else if(sent != (ssize_t)tosend)
+				ev |= ev1;
+				if( (ev1 & LV2_OSC_ERR) || blocked)
 				{
-					ev = LV2_OSC_STREAM_ERRNO(ev, EIO);
 					break;
 				}
-
-				stream->driv->read_adv(stream->data);
-				ev |= LV2_OSC_SEND;
 			}
 		}
 	}
@@ -1227,118 +4590,145 @@ _lv2_osc_stream_run_ser(LV2_OSC_Stream *stream)
 
 		if(fd >= 0)
 		{
-			if(stream->slip) // SLIP framed
+			bool closed;
+
+			ev |= _lv2_osc_stream_recv_frames(stream, fd, &stream->rx, &closed);
+
+			if(closed)
 			{
-				while(true)
-				{
-					ssize_t recvd = read(fd, stream->rx_buf + stream->rx_off,
-						sizeof(stream->rx_buf) - stream->rx_off);
+				stream->connected = false;
+			}
+		}
+	}
 
-					if(recvd == -1)
-					{
-						if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-						{
-							// empty queue
-							break;
-						}
+	if(stream->connected)
+	{
+		ev |= LV2_OSC_CONN;
+	}
 
-						stream->connected = false;
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						break;
-					}
-					else if(recvd == 0)
-					{
-						// orderly shutdown
-						break;
-					}
+	return ev;
+}
 
-					uint8_t *ptr = stream->rx_buf;
-					recvd += stream->rx_off;
+#if LV2_OSC_STREAM_SHM
+// wake consumer of ring, if it is blocked
+static inline void
+_lv2_osc_stream_shm_wake(LV2_OSC_Shm_Wake *wake)
+{
+	atomic_fetch_add_explicit(&wake->seq, 1, memory_order_seq_cst);
+	atomic_thread_fence(memory_order_seq_cst);
 
-					while(recvd > 0)
-					{
-						size_t size;
-						size_t parsed = lv2_osc_slip_decode_inline(ptr, recvd, &size);
-
-						if(size) // dispatch
-						{
-							uint8_t *buf;
-
-							if( (buf = stream->driv->write_req(stream->data, size, NULL)) )
-							{
-								memcpy(buf, ptr, size);
-
-								stream->driv->write_adv(stream->data, size);
-								ev |= LV2_OSC_RECV;
-							}
-							else
-							{
-								parsed = 0;
-								ev = LV2_OSC_STREAM_ERRNO(ev, ENOMEM);
-							}
-						}
-
-						if(parsed)
-						{
-							ptr += parsed;
-							recvd -= parsed;
-						}
-						else
-						{
-							break;
-						}
-					}
+	// no syscall as long as consumer keeps polling
+	if(atomic_load_explicit(&wake->waiting, memory_order_seq_cst))
+	{
+		syscall(SYS_futex, &wake->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+	}
+}
 
-					if(recvd > 0) // is there remaining chunk for next call?
-					{
-						memmove(stream->rx_buf, ptr, recvd);
-						stream->rx_off = recvd;
-					}
-					else
-					{
-						stream->rx_off = 0;
-					}
+// block until ring is non-empty, woken up or timed out
+static inline void
+_lv2_osc_stream_shm_wait(LV2_OSC_Stream *stream, int timeout_ms)
+{
+	LV2_OSC_Shm_Wake *wake = stream->shmem.rx_wake;
+	struct timespec ts;
+	size_t len;
 
-					break;
-				}
+	const unsigned seq = atomic_load_explicit(&wake->seq, memory_order_seq_cst);
+	atomic_store_explicit(&wake->waiting, 1, memory_order_seq_cst);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if(!varchunk_read_request(stream->shmem.rx, &len)) // still empty
+	{
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+		syscall(SYS_futex, &wake->seq, FUTEX_WAIT, seq,
+			(timeout_ms < 0) ? NULL : &ts, NULL, 0);
+	}
+
+	atomic_store_explicit(&wake->waiting, 0, memory_order_relaxed);
+}
+
+static inline LV2_OSC_Enum
+_lv2_osc_stream_run_shm(LV2_OSC_Stream *stream)
+{
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+
+	// (re)attach client
+	if(!stream->shmem.map && !stream->server)
+	{
+		ev |= _lv2_osc_stream_shm_attach(stream);
+	}
+
+	LV2_OSC_Shm *map = stream->shmem.map;
+	if(!map)
+	{
+		return ev;
+	}
+
+	if(atomic_load_explicit(&map->magic, memory_order_acquire)
+		!= LV2_OSC_STREAM_SHM_MAGIC) // server has gone
+	{
+		_lv2_osc_stream_shm_deinit(stream);
+		return ev;
+	}
+
+	if(stream->server)
+	{
+		stream->connected = atomic_load_explicit(&map->clients,
+			memory_order_acquire) > 0;
+	}
+
+	// send everything
+	{
+		const uint8_t *buf;
+		size_t tosend;
+		bool sent = false;
+
+		while( (buf = stream->driv->read_req(stream->data, &tosend)) )
+		{
+			if(tosend > map->size / 4) // might never fit into ring
+			{
+				stream->driv->read_adv(stream->data);
+				ev = LV2_OSC_STREAM_ERRNO(ev, EMSGSIZE);
+				continue;
 			}
-			else // uint32_t prefix frames
+
+			uint8_t *dst = varchunk_write_request(stream->shmem.tx, tosend);
+			if(!dst) // ring full, retry in next run
 			{
-				uint8_t *buf;
-				
-				while( (buf = stream->driv->write_req(stream->data,
-					LV2_OSC_STREAM_REQBUF, NULL)) )
-				{
-					uint32_t prefix;
+				break;
+			}
 
-					ssize_t recvd = read(fd, &prefix, sizeof(uint32_t));
-					if(recvd == sizeof(uint32_t))
-					{
-						prefix = ntohl(prefix); //FIXME check prefix <= max_len
-						recvd = read(fd, buf, prefix);
-					}
-					else if(recvd == -1)
-					{
-						if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
-						{
-							// empty queue
-							break;
-						}
+			memcpy(dst, buf, tosend);
+			varchunk_write_advance(stream->shmem.tx, tosend);
+			stream->driv->read_adv(stream->data);
+			ev |= LV2_OSC_SEND;
+			sent = true;
+		}
 
-						stream->connected = false;
-						ev = LV2_OSC_STREAM_ERRNO(ev, errno);
-						break;
-					}
-					else if(recvd == 0)
-					{
-						// orderly shutdown
-						break;
-					}
+		if(sent)
+		{
+			_lv2_osc_stream_shm_wake(stream->shmem.tx_wake);
+		}
+	}
 
-					stream->driv->write_adv(stream->data, recvd);
-					ev |= LV2_OSC_RECV;
-				}
+	// recv everything
+	{
+		const uint8_t *src;
+		size_t len;
+
+		while( (src = varchunk_read_request(stream->shmem.rx, &len)) )
+		{
+			uint8_t *dst = stream->driv->write_req(stream->data, len, NULL);
+			if(!dst)
+			{
+				break;
 			}
+
+			memcpy(dst, src, len);
+			stream->driv->write_adv(stream->data, len);
+			varchunk_read_advance(stream->shmem.rx);
+			ev |= LV2_OSC_RECV;
 		}
 	}
 
@@ -1349,12 +4739,48 @@ _lv2_osc_stream_run_ser(LV2_OSC_Stream *stream)
 
 	return ev;
 }
+#endif
 
 static inline LV2_OSC_Enum
 lv2_osc_stream_run(LV2_OSC_Stream *stream)
 {
 	LV2_OSC_Enum ev = LV2_OSC_NONE;
 
+#if LV2_OSC_STREAM_SHM
+	if(stream->shm)
+	{
+		return _lv2_osc_stream_run_shm(stream);
+	}
+#endif
+
+	// reinitialize clients pending resolution or after failure, when due
+	if(!stream->server && !stream->serial && (stream->sock < 0) )
+	{
+		const LV2_OSC_Resolve *job = stream->resolve.job;
+
+		if(job && !atomic_load_explicit(&job->done, memory_order_acquire))
+		{
+			return ev;
+		}
+
+		if(_lv2_osc_stream_now_ms() < stream->conn.retry)
+		{
+			return ev;
+		}
+
+		ev |= _lv2_osc_stream_reinit(stream);
+
+		if(ev & LV2_OSC_ERR)
+		{
+			_lv2_osc_stream_backoff(stream);
+		}
+
+		if(stream->sock < 0)
+		{
+			return ev;
+		}
+	}
+
 	switch(stream->socket_type)
 	{
 		case SOCK_DGRAM:
@@ -1374,6 +4800,75 @@ lv2_osc_stream_run(LV2_OSC_Stream *stream)
 	return ev;
 }
 
+// number of live peers, UDP and TCP servers may have many, others at most one
+static inline unsigned
+lv2_osc_stream_get_peers(LV2_OSC_Stream *stream)
+{
+	if( (stream->socket_type == SOCK_STREAM) && stream->server)
+	{
+		unsigned nclients = 0;
+
+		for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+		{
+			if(stream->clients[i].fd >= 0)
+			{
+				nclients += 1;
+			}
+		}
+
+		return nclients;
+	}
+
+	if(stream->socket_type != SOCK_DGRAM)
+	{
+		return stream->connected ? 1 : 0;
+	}
+
+	if(!stream->server)
+	{
+		return stream->peer.len ? 1 : 0;
+	}
+
+	unsigned npeers = 0;
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_PEERS; i++)
+	{
+		if(stream->peers[i].seen)
+		{
+			npeers += 1;
+		}
+	}
+
+	return npeers;
+}
+
+// peer in given UDP server slot or NULL if unused
+static inline const LV2_OSC_Peer *
+lv2_osc_stream_get_peer(LV2_OSC_Stream *stream, unsigned idx)
+{
+	if( (idx >= LV2_OSC_STREAM_PEERS) || !stream->peers[idx].seen)
+	{
+		return NULL;
+	}
+
+	return &stream->peers[idx];
+}
+
+// send to given UDP server slot only, or to all with LV2_OSC_STREAM_PEER_ALL
+static inline int
+lv2_osc_stream_select_peer(LV2_OSC_Stream *stream, int idx)
+{
+	if( (idx != LV2_OSC_STREAM_PEER_ALL)
+		&& ( (idx < 0) || (idx >= LV2_OSC_STREAM_PEERS) || !stream->peers[idx].seen) )
+	{
+		return 1;
+	}
+
+	stream->peer_sel = idx;
+
+	return 0;
+}
+
 static inline int
 lv2_osc_stream_get_file_descriptors(LV2_OSC_Stream *stream, int fds [2])
 {
@@ -1385,43 +4880,116 @@ lv2_osc_stream_get_file_descriptors(LV2_OSC_Stream *stream, int fds [2])
 	fds[0] = stream->sock;
 	fds[1] = stream->fd;
 
+	// first client of a TCP server
+	for(unsigned i = 0; (fds[1] < 0) && (i < LV2_OSC_STREAM_CLIENTS); i++)
+	{
+		fds[1] = stream->clients[i].fd;
+	}
+
 	return 0;
 }
 
-static inline LV2_OSC_Enum
-lv2_osc_stream_pollin(LV2_OSC_Stream *stream, int timeout_ms)
+// fills in all open file descriptors, e.g. of every TCP server client,
+// returns their number
+static inline unsigned
+lv2_osc_stream_get_all_file_descriptors(LV2_OSC_Stream *stream,
+	int fds [LV2_OSC_STREAM_FDS])
 {
-	int fd [2];
+	unsigned nfds = 0;
 
-	if(lv2_osc_stream_get_file_descriptors(stream, fd) != 0)
+	if(stream->sock >= 0)
 	{
-		return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, EBADF);
+		fds[nfds++] = stream->sock;
 	}
 
-	struct pollfd fds [2] = {
-		[0] = {
-			.fd = fd[0],
-			.events = POLLIN,
-			.revents = 0
-		},
-		[1] = {
-			.fd = fd[1],
-			.events = POLLIN,
-			.revents = 0
+	if(stream->fd >= 0)
+	{
+		fds[nfds++] = stream->fd;
+	}
+
+#if LV2_OSC_STREAM_URING
+	if(stream->uring.fd >= 0) // readable upon completions
+	{
+		fds[nfds++] = stream->uring.fd;
+	}
+#endif
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+	{
+		if(stream->clients[i].fd >= 0)
+		{
+			fds[nfds++] = stream->clients[i].fd;
 		}
-	};
+	}
+
+	return nfds;
+}
+
+// block until stream is readable or timeout_ms has passed, shared memory
+// streams without file descriptors block on a futex instead
+static inline LV2_OSC_Enum
+lv2_osc_stream_wait(LV2_OSC_Stream *stream, int timeout_ms)
+{
+	int fd [LV2_OSC_STREAM_FDS];
+	struct pollfd fds [LV2_OSC_STREAM_FDS];
+
+#if LV2_OSC_STREAM_SHM
+	if(stream->shmem.map)
+	{
+		_lv2_osc_stream_shm_wait(stream, timeout_ms);
+		return LV2_OSC_NONE;
+	}
+#endif
+
+	const unsigned nfds = lv2_osc_stream_get_all_file_descriptors(stream, fd);
+
+	for(unsigned i = 0; i < nfds; i++)
+	{
+		fds[i].fd = fd[i];
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
 
-	const int res = poll(fds, 2, timeout_ms);
+	const int res = poll(fds, nfds, timeout_ms);
 	if(res < 0)
 	{
 		return LV2_OSC_STREAM_ERRNO(LV2_OSC_NONE, errno);
 	}
 
-#if 0
-	fprintf(stderr, "++ %i: %i %i %i %i\n", res,
-		fds[0].fd, (int)fds[0].revents,
-		fds[1].fd, (int)fds[1].revents);
+	return LV2_OSC_NONE;
+}
+
+// wake up a thread blocked in lv2_osc_stream_wait on a shared memory stream,
+// e.g. to send freshly queued packets, no-op for other streams, may be called
+// from any thread while another one runs, reinitializes or deinitializes it
+static inline void
+lv2_osc_stream_wake(LV2_OSC_Stream *stream)
+{
+#if LV2_OSC_STREAM_SHM
+	atomic_fetch_add_explicit(&stream->shmem.wakers, 1, memory_order_seq_cst);
+
+	LV2_OSC_Shm_Wake *wake = atomic_load_explicit(&stream->shmem.waker,
+		memory_order_seq_cst);
+	if(wake)
+	{
+		_lv2_osc_stream_shm_wake(wake);
+	}
+
+	atomic_fetch_sub_explicit(&stream->shmem.wakers, 1, memory_order_release);
+#else
+	(void)stream;
 #endif
+}
+
+static inline LV2_OSC_Enum
+lv2_osc_stream_pollin(LV2_OSC_Stream *stream, int timeout_ms)
+{
+	const LV2_OSC_Enum ev = lv2_osc_stream_wait(stream, timeout_ms);
+
+	if(ev & LV2_OSC_ERR)
+	{
+		return ev;
+	}
 
 	return lv2_osc_stream_run(stream);
 }
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2015-2016 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <osc.lv2/writer.h>
+#include <osc.lv2/stream.h>
+
+#define COUNT 200000
+#define BATCH 32 // packets queued per cycle
+#define SLIP_COUNT 20000
+#define SLIP_SIZE 0x1000
+
+typedef struct _bench_t bench_t;
+
+struct _bench_t {
+	uint8_t pkt [64];
+	size_t pkt_size;
+	unsigned queued;
+	unsigned peek; // packets handed out past the first one
+	unsigned sent;
+	unsigned received;
+	uint8_t rx [0x10000];
+};
+
+static void *
+_write_req(void *data, size_t minimum, size_t *maximum)
+{
+	bench_t *bench = data;
+
+	(void)minimum;
+
+	if(maximum)
+	{
+		*maximum = sizeof(bench->rx);
+	}
+
+	return bench->rx;
+}
+
+static void
+_write_adv(void *data, size_t written)
+{
+	bench_t *bench = data;
+
+	assert(written == bench->pkt_size);
+	bench->received += 1;
+}
+
+static const void *
+_read_req(void *data, size_t *toread)
+{
+	bench_t *bench = data;
+
+	if(!bench->queued)
+	{
+		return NULL;
+	}
+
+	*toread = bench->pkt_size;
+	bench->peek = 0;
+
+	return bench->pkt;
+}
+
+static const void *
+_read_next(void *data, size_t *toread)
+{
+	bench_t *bench = data;
+
+	if(bench->peek + 1 >= bench->queued)
+	{
+		return NULL;
+	}
+
+	*toread = bench->pkt_size;
+	bench->peek += 1;
+
+	return bench->pkt;
+}
+
+static void
+_read_adv(void *data)
+{
+	bench_t *bench = data;
+
+	bench->queued -= 1;
+	bench->sent += 1;
+}
+
+static const LV2_OSC_Driver driv = {
+	.write_req = _write_req,
+	.write_adv = _write_adv,
+	.read_req = _read_req,
+	.read_adv = _read_adv,
+	.read_next = _read_next
+};
+
+static double
+_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// push small messages from client to server over loopback
+static void
+_bench(const char *server_url, const char *client_url)
+{
+	static LV2_OSC_Stream server;
+	static LV2_OSC_Stream client;
+	static bench_t tx;
+	static bench_t rx;
+	LV2_OSC_Writer writer;
+
+	memset(&tx, 0x0, sizeof(tx));
+	memset(&rx, 0x0, sizeof(rx));
+
+	lv2_osc_writer_initialize(&writer, tx.pkt, sizeof(tx.pkt));
+	assert(lv2_osc_writer_message_vararg(&writer, "/bench", "i", 0));
+	assert(lv2_osc_writer_finalize(&writer, &tx.pkt_size));
+	rx.pkt_size = tx.pkt_size;
+
+	assert(lv2_osc_stream_init(&server, server_url, &driv, &rx) == 0);
+	assert(lv2_osc_stream_init(&client, client_url, &driv, &tx) == 0);
+
+	unsigned cycles = 0;
+	const double t0 = _now();
+
+	while(tx.sent < COUNT)
+	{
+		if(tx.queued == 0)
+		{
+			tx.queued = (COUNT - tx.sent < BATCH)
+				? COUNT - tx.sent
+				: BATCH;
+		}
+
+		lv2_osc_stream_run(&client);
+		lv2_osc_stream_run(&server);
+		cycles += 1;
+	}
+
+	// drain
+	for(unsigned i = 0; i < 100; i++)
+	{
+		lv2_osc_stream_run(&client);
+		lv2_osc_stream_run(&server);
+	}
+
+	const double t1 = _now();
+	const double dt = t1 - t0;
+
+	fprintf(stdout, "%-40s %9.0f pkt/s %6.2f%% received, %u cycles\n",
+		client_url, tx.sent / dt, 100.0 * rx.received / tx.sent, cycles);
+
+	assert(lv2_osc_stream_deinit(&client) == 0);
+	assert(lv2_osc_stream_deinit(&server) == 0);
+}
+
+// byte-wise SLIP decoder as reference for the vectorized one
+static size_t
+_slip_decode_scalar(uint8_t *dst, size_t len, size_t *size)
+{
+	const uint8_t *src = dst;
+	const uint8_t *end = dst + len;
+	uint8_t *ptr = dst;
+	bool whole = false;
+
+	if( (src < end) && (*src == SLIP_END) )
+	{
+		whole = true;
+		src++;
+	}
+
+	while(src < end)
+	{
+		if(*src == SLIP_ESC)
+		{
+			if(src == end-1)
+				break;
+
+			src++;
+			if(*src == SLIP_END_REPLACE)
+				*ptr++ = SLIP_END;
+			else if(*src == SLIP_ESC_REPLACE)
+				*ptr++ = SLIP_ESC;
+			src++;
+		}
+		else if(*src == SLIP_END)
+		{
+			src++;
+
+			*size = whole ? ptr - dst : 0;
+			return src - dst;
+		}
+		else
+		{
+			*ptr++ = *src++;
+		}
+	}
+
+	*size = 0;
+	return 0;
+}
+
+// byte-wise SLIP encoder as reference, copy and escape in place
+static size_t
+_slip_encode_scalar(uint8_t *dst, size_t max, const uint8_t *src, size_t len)
+{
+	if(len > max)
+	{
+		return 0;
+	}
+
+	memcpy(dst, src, len);
+
+	const uint8_t *end = dst + len;
+	size_t size = 2;
+
+	for(const uint8_t *from = dst; from < end; from++, size++)
+	{
+		if( (*from == SLIP_END) || (*from == SLIP_ESC) )
+			size++;
+	}
+
+	uint8_t *to = dst + size - 1;
+	*to-- = SLIP_END;
+	for(const uint8_t *from = end - 1; from >= dst; from--)
+	{
+		if(*from == SLIP_END)
+		{
+			*to-- = SLIP_END_REPLACE;
+			*to-- = SLIP_ESC;
+		}
+		else if(*from == SLIP_ESC)
+		{
+			*to-- = SLIP_ESC_REPLACE;
+			*to-- = SLIP_ESC;
+		}
+		else
+			*to-- = *from;
+	}
+	*to = SLIP_END;
+
+	return size;
+}
+
+typedef size_t (*slip_encode_t)(uint8_t *dst, size_t max, const uint8_t *src,
+	size_t len);
+typedef size_t (*slip_decode_t)(uint8_t *dst, size_t len, size_t *size);
+
+// encode and decode payloads with a given share of special bytes per mille
+static void
+_bench_slip(const char *label, slip_encode_t encode, slip_decode_t decode,
+	unsigned share)
+{
+	static uint8_t src [SLIP_SIZE];
+	static uint8_t dst [SLIP_SIZE*2 + 2];
+
+	srand(share);
+	for(size_t i = 0; i < SLIP_SIZE; i++)
+	{
+		const unsigned r = rand() % 1000;
+
+		src[i] = (r < share)
+			? ((r & 1) ? SLIP_END : SLIP_ESC)
+			: (uint8_t)(r & 0x3f);
+	}
+
+	double tenc = 0.0;
+	double tdec = 0.0;
+
+	for(unsigned i = 0; i < SLIP_COUNT; i++)
+	{
+		const double t0 = _now();
+		const size_t size = encode(dst, sizeof(dst), src, SLIP_SIZE);
+		const double t1 = _now();
+		size_t len;
+		assert(decode(dst, size, &len) == size);
+		const double t2 = _now();
+
+		assert(len == SLIP_SIZE);
+		tenc += t1 - t0;
+		tdec += t2 - t1;
+	}
+
+	assert(memcmp(dst, src, SLIP_SIZE) == 0);
+
+	const double bytes = (double)SLIP_COUNT * SLIP_SIZE;
+
+	fprintf(stdout, "%-12s %4.1f%% escaped %9.1f MB/s encode %9.1f MB/s decode\n",
+		label, share / 10.0, bytes / tenc * 1e-6, bytes / tdec * 1e-6);
+}
+
+int
+main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+{
+	const unsigned shares [] = { 0, 1, 10, 100 };
+
+	for(unsigned s = 0; s < sizeof(shares)/sizeof(unsigned); s++)
+	{
+		_bench_slip("slip.scalar", _slip_encode_scalar, _slip_decode_scalar,
+			shares[s]);
+		_bench_slip("slip", lv2_osc_slip_encode, lv2_osc_slip_decode_inline,
+			shares[s]);
+	}
+
+	_bench("osc.udp://:2345", "osc.udp://localhost:2345");
+	_bench("osc.unix:///tmp/osc_bench.sock", "osc.unix://localhost/tmp/osc_bench.sock");
+	_bench("osc.prefix.tcp://:2347", "osc.prefix.tcp://localhost:2347");
+	_bench("osc.slip.tcp://:2348", "osc.slip.tcp://localhost:2348");
+#if LV2_OSC_STREAM_URING
+	_bench("osc.udp://:2346?uring", "osc.udp://localhost:2346?uring");
+#endif
+
+	return 0;
+}
@@ -3,13 +3,16 @@
 #include <stdio.h>
 #include <pthread.h>
 #include <time.h>
+#include <stdatomic.h>
 
 #include <osc.lv2/osc.h>
 #include <osc.lv2/reader.h>
 #include <osc.lv2/writer.h>
 #include <osc.lv2/forge.h>
 #if !defined(_WIN32)
+#	define LV2_OSC_STREAM_FRAME_MAX 0x40000 // reachable by frame tests
 #	include <osc.lv2/stream.h>
+#	include <sys/wait.h>
 #endif
 
 #define BUF_SIZE 0x100000
@@ -483,11 +486,31 @@ struct _stash_t {
 	size_t size;
 	item_t **items;
 	item_t *rsvd;
+	size_t cap; // maximum number of items, 0 for unbounded
+	size_t max; // maximum size of items, 0 for unbounded
+	size_t peek; // index of item returned last by read_req or read_next
 };
 
+#define STASH_MAX 0x40000 // 256K, room for a batch of datagrams
+
 static uint8_t *
 _stash_write_req(stash_t *stash, size_t minimum, size_t *maximum)
 {
+	if(stash->cap && (stash->size >= stash->cap))
+	{
+		return NULL; // full
+	}
+
+	if(stash->max && (minimum > stash->max))
+	{
+		return NULL; // never fits
+	}
+
+	if(maximum && (minimum < STASH_MAX))
+	{
+		minimum = STASH_MAX;
+	}
+
 	if(!stash->rsvd || (stash->rsvd->size < minimum))
 	{
 		const size_t sz = sizeof(item_t) + minimum;
@@ -509,6 +532,8 @@ _stash_write_adv(stash_t *stash, size_t written)
 {
 	assert(stash->rsvd);
 	assert(stash->rsvd->size >= written);
+	stash->rsvd = realloc(stash->rsvd, sizeof(item_t) + written);
+	assert(stash->rsvd);
 	stash->rsvd->size = written;
 	stash->size += 1;
 	stash->items = realloc(stash->items, sizeof(item_t *) * stash->size);
@@ -536,6 +561,23 @@ _stash_read_req(stash_t *stash, size_t *size)
 		*size = item->size;
 	}
 
+	stash->peek = 0;
+
+	return item->buf;
+}
+
+static const uint8_t *
+_stash_read_next(stash_t *stash, size_t *size)
+{
+	if(stash->peek + 1 >= stash->size)
+	{
+		return NULL;
+	}
+
+	item_t *item = stash->items[++stash->peek];
+
+	*size = item->size;
+
 	return item->buf;
 }
 
@@ -587,11 +629,37 @@ _read_adv(void *data)
 	_stash_read_adv(&stash[1]);
 }
 
+static const void *
+_read_next(void *data, size_t *toread)
+{
+	stash_t *stash = data;
+
+	return _stash_read_next(&stash[1], toread);
+}
+
+static size_t
+_write_max(void *data)
+{
+	stash_t *stash = data;
+
+	return stash[0].max;
+}
+
 static const LV2_OSC_Driver driv = {
 	.write_req = _write_req,
 	.write_adv = _write_adv,
 	.read_req = _read_req,
-	.read_adv = _read_adv
+	.read_adv = _read_adv,
+	.read_next = _read_next
+};
+
+static const LV2_OSC_Driver driv_max = {
+	.write_req = _write_req,
+	.write_adv = _write_adv,
+	.read_req = _read_req,
+	.read_adv = _read_adv,
+	.read_next = _read_next,
+	.write_max = _write_max
 };
 
 #define COUNT 128
@@ -882,6 +950,19 @@ static const pair_t pairs [] = {
 		.lossy = true
 	},
 
+#if LV2_OSC_STREAM_URING
+	{
+		.server = "osc.udp://:2233?uring",
+		.client = "osc.udp://localhost:2233?uring",
+		.lossy = true
+	},
+	{
+		.server = "osc.udp://[]:3355?uring=1",
+		.client = "osc.udp://[::1]:3355",
+		.lossy = true
+	},
+#endif
+
 	{
 		.server = "osc.tcp://:4444",
 		.client = "osc.tcp://localhost:4444",
@@ -915,6 +996,25 @@ static const pair_t pairs [] = {
 		.lossy = false
 	},
 
+	{
+		.server = "osc.unix:///tmp/osc_test_dgram.sock",
+		.client = "osc.unix://localhost/tmp/osc_test_dgram.sock",
+		.lossy = true
+	},
+	{
+		.server = "osc.unix.slip:///tmp/osc_test_stream.sock",
+		.client = "osc.unix.slip://localhost/tmp/osc_test_stream.sock",
+		.lossy = false
+	},
+
+#if LV2_OSC_STREAM_SHM
+	{
+		.server = "osc.shm:///osc_test",
+		.client = "osc.shm://localhost/osc_test",
+		.lossy = false
+	},
+#endif
+
 #if 0
 	{
 		.server = "osc.serial:///dev/pts/4", //FIXME baudrate
@@ -929,223 +1029,1544 @@ static const pair_t pairs [] = {
 		.lossy = false
 	}
 };
-#endif
-
-#if !defined(_WIN32)
-static unsigned foo_sub_one = 0;
-static unsigned foo_sub_two [2] = { 0, 0 };
-static unsigned foo = 0;
-static unsigned bar = 0;
 
 static void
-_one(const char *path, unsigned *flag)
+_stash_free(stash_t *stash)
 {
-	*flag += 1;
-
-	if(!path)
+	free(stash->rsvd);
+	while(stash->size)
 	{
-		return;
+		_stash_read_adv(stash);
 	}
-
-	assert(!strcmp(path, "/sub/one")
-		|| !strcmp(path, "/*/one")
-		|| !strcmp(path, "/s*/one")
-		|| !strcmp(path, "/su*/one")
-		|| !strcmp(path, "/sub*/one")
-		|| !strcmp(path, "/sub/*")
-		|| !strcmp(path, "/*sub/one")
-		|| !strcmp(path, "/*s*u*b*/one")
-		|| !strcmp(path, "/su[ab]/one")
-		|| !strcmp(path, "/su[a-b]/[!a-np-z]ne")
-		|| !strcmp(path, "/su[a-b]/one")
-		|| !strcmp(path, "/s?b/?ne")
-		|| !strcmp(path, "/s?*/?ne")
-		|| !strcmp(path, "/s?*/*?e")
-		|| !strcmp(path, "/sub/{one,two}"));
+	free(stash->items);
 }
 
 static void
-_two(const char *path, unsigned *flag)
+_peers_send(stash_t *stash, const char *path, int32_t i)
 {
-	*flag += 1;
+	LV2_OSC_Writer writer;
+	uint8_t *buf_tx;
+	size_t max;
+	size_t writ;
 
-	if(!path)
-	{
-		return;
-	}
+	assert( (buf_tx = _stash_write_req(&stash[1], 1024, &max)) );
+	lv2_osc_writer_initialize(&writer, buf_tx, max);
+	assert(lv2_osc_writer_message_vararg(&writer, path, "i", i));
+	assert(lv2_osc_writer_finalize(&writer, &writ) == buf_tx);
 
-	assert(!strcmp(path, "/sub/two")
-		|| !strcmp(path, "/sub/*")
-		|| !strcmp(path, "/sub/{one,two}"));
+	_stash_write_adv(&stash[1], writ);
 }
 
 static void
-_foo(const char *path, unsigned *flag)
+_peers_send_blob(stash_t *stash, const char *path, const uint8_t *blob,
+	int32_t size)
 {
-	*flag += 1;
+	LV2_OSC_Writer writer;
+	uint8_t *buf_tx;
+	size_t max;
+	size_t writ;
 
-	if(!path)
-	{
-		return;
-	}
+	assert( (buf_tx = _stash_write_req(&stash[1], size + 64, &max)) );
+	lv2_osc_writer_initialize(&writer, buf_tx, max);
+	assert(lv2_osc_writer_message_vararg(&writer, path, "b", size, blob));
+	assert(lv2_osc_writer_finalize(&writer, &writ) == buf_tx);
 
-	assert(!strcmp(path, "/foo")
-		|| !strcmp(path, "/{foo,bar}"));
+	_stash_write_adv(&stash[1], writ);
 }
 
 static void
-_bar(const char *path, unsigned *flag)
+_peers_recv(LV2_OSC_Stream *stream, stash_t *stash, unsigned count)
 {
-	*flag += 1;
+	const time_t t0 = time(NULL);
 
-	if(!path)
+	while(stash[0].size < count)
 	{
-		return;
+		assert( (lv2_osc_stream_run(stream) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert(difftime(time(NULL), t0) < 2.0);
 	}
-
-	assert(!strcmp(path, "/bar")
-		|| !strcmp(path, "/{foo,bar}"));
 }
 
+// run until queued packet is sent, e.g. once host name has been resolved
 static void
-_hook_one(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
-	void *data)
+_peers_flush(LV2_OSC_Stream *stream)
 {
-	_one(path, data);
-}
+	const time_t t0 = time(NULL);
 
-static void
-_hook_two(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
-	void *data)
-{
-	_two(path, data);
+	while( !(lv2_osc_stream_run(stream) & LV2_OSC_SEND) )
+	{
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
 }
 
-static void
-_hook_foo(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
-	void *data)
+static int
+_run_test_peers(void)
 {
-	_foo(path, data);
-}
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(2, sizeof(LV2_OSC_Stream));
+	stash_t stash [3][2];
 
-static void
-_hook_bar(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
-	void *data)
-{
-	_bar(path, data);
-}
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
 
-static LV2_OSC_Hook hook_sub [] = {
-	{ .name = "one", .method = _hook_one, .data = &foo_sub_one },
-	{ .name = "two", .method = _hook_two, .data = &foo_sub_two[0] },
-	{ .name = "two", .method = _hook_two, .data = &foo_sub_two[1] },
-	{ .name = NULL }
-};
+	assert(lv2_osc_stream_init(server, "osc.udp://:2233", &driv, stash[0]) == 0);
+	assert(lv2_osc_stream_get_peers(server) == 0);
 
-static LV2_OSC_Hook hook_root [] = {
-	{ .name = "foo", .method = _hook_foo, .data = &foo },
-	{ .name = "bar", .method = _hook_bar, .data = &bar },
-	{ .name = "sub", .hooks = hook_sub },
-	{ .name = NULL }
-};
+	// register both clients as peers
+	for(unsigned c = 0; c < 2; c++)
+	{
+		assert(lv2_osc_stream_init(&client[c], "osc.udp://localhost:2233", &driv,
+			stash[1+c]) == 0);
 
-static LV2_OSC_Tree tree_sub [4];
+		_peers_send(stash[1+c], "/hello", c);
+		_peers_flush(&client[c]);
+	}
 
-static void
-_branch_one(LV2_OSC_Reader *reader __attribute__((unused)),
-	LV2_OSC_Arg *arg __attribute__((unused)),
-	const LV2_OSC_Tree *tree __attribute__((unused)),
-	void *data __attribute__((unused)))
-{
-	_one(NULL, &foo_sub_one);
-}
+	_peers_recv(server, stash[0], 2);
+	assert(lv2_osc_stream_get_peers(server) == 2);
 
-static void
-_branch_two(LV2_OSC_Reader *reader __attribute__((unused)),
-	LV2_OSC_Arg *arg __attribute__((unused)),
-	const LV2_OSC_Tree *tree __attribute__((unused)),
-	void *data __attribute__((unused)))
-{
-	const size_t idx = tree - &tree_sub[1];
+	// fan out to all peers
+	_peers_send(stash[0], "/all", 0);
+	assert(lv2_osc_stream_run(server) & LV2_OSC_SEND);
+	assert(stash[0][1].size == 0);
 
-	_two(NULL, &foo_sub_two[idx]);
-}
+	for(unsigned c = 0; c < 2; c++)
+	{
+		_peers_recv(&client[c], stash[1+c], 1);
+		assert(stash[1+c][0].size == 1);
+		_stash_read_adv(&stash[1+c][0]);
+	}
 
-static void
-_branch_foo(LV2_OSC_Reader *reader __attribute__((unused)),
-	LV2_OSC_Arg *arg __attribute__((unused)),
-	const LV2_OSC_Tree *tree __attribute__((unused)),
-	void *data __attribute__((unused)))
-{
-	_foo(NULL, &foo);
-}
+	// send to selected peer only
+	unsigned sel = 0;
+	const LV2_OSC_Peer *peer;
 
-static void
-_branch_bar(LV2_OSC_Reader *reader __attribute__((unused)),
-	LV2_OSC_Arg *arg __attribute__((unused)),
-	const LV2_OSC_Tree *tree __attribute__((unused)),
-	void *data __attribute__((unused)))
-{
-	_bar(NULL, &bar);
-}
+	while( !(peer = lv2_osc_stream_get_peer(server, sel)) )
+	{
+		sel++;
+	}
 
-static LV2_OSC_Tree tree_sub [] = {
-	{ .name = "one", .branch = _branch_one },
-	{ .name = "two", .branch = _branch_two },
-	{ .name = "two", .branch = _branch_two },
-	{ .name = NULL }
-};
+	assert( (peer->sent == 1) && (peer->received == 1) );
+	assert(lv2_osc_stream_select_peer(server, LV2_OSC_STREAM_PEERS) != 0);
+	assert(lv2_osc_stream_select_peer(server, sel) == 0);
 
-static LV2_OSC_Tree tree_root [] = {
-	{ .name = "foo", .branch = _branch_foo },
-	{ .name = "bar", .branch = _branch_bar },
-	{ .name = "sub", .trees = tree_sub },
-	{ .name = NULL }
-};
+	_peers_send(stash[0], "/sel", 1);
+	assert(lv2_osc_stream_run(server) & LV2_OSC_SEND);
+	assert(peer->sent == 2);
 
-static bool
-_run_test_hooks_internal(const char *path)
-{
-	foo_sub_one = foo_sub_two[0] = foo_sub_two[1] = foo = bar = false;
+	const time_t t0 = time(NULL);
+	while(difftime(time(NULL), t0) < 1.0)
+	{
+		for(unsigned c = 0; c < 2; c++)
+		{
+			lv2_osc_stream_run(&client[c]);
+		}
+	}
+
+	assert(stash[1][0].size + stash[2][0].size == 1);
 
+	for(unsigned c = 0; c < 2; c++)
 	{
-		LV2_OSC_URID osc_urid;
-		LV2_Atom_Forge forge;
+		assert(lv2_osc_stream_deinit(&client[c]) == 0);
+		_stash_free(&stash[1+c][0]);
+		_stash_free(&stash[1+c][1]);
+	}
 
-		lv2_osc_urid_init(&osc_urid, &map);
-		lv2_atom_forge_init(&forge, &map);
+	assert(lv2_osc_stream_deinit(server) == 0);
+	_stash_free(&stash[0][0]);
+	_stash_free(&stash[0][1]);
 
-		lv2_atom_forge_set_buffer(&forge, buf0, BUF_SIZE);
-		assert(lv2_osc_forge_message_vararg(&forge, &osc_urid, path, ""));
+	free(client);
+	free(server);
 
-		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)buf0;;
-		assert(lv2_osc_unroll(&osc_urid, obj, lv2_osc_hooks, hook_root) == true);
+	return 0;
+}
+
+static int
+_run_test_jumbo(const char *server_url, const char *client_url)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [2][2];
+	static uint8_t blob [0x8000];
+
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
+	memset(blob, 0x5a, sizeof(blob));
+
+	assert(lv2_osc_stream_init(server, server_url, &driv, stash[0]) == 0);
+	assert(lv2_osc_stream_init(client, client_url, &driv, stash[1]) == 0);
+
+	// datagram larger than batch buffers in between small ones
+	_peers_send(stash[1], "/small", 0);
+	_peers_send_blob(stash[1], "/jumbo", blob, sizeof(blob));
+	_peers_send(stash[1], "/small", 1);
+
+	while(stash[1][1].size)
+	{
+		lv2_osc_stream_run(client);
 	}
 
+	_peers_recv(server, stash[0], 3);
+
+	for(unsigned i = 0; i < 3; i++)
 	{
-		LV2_OSC_Writer writer;
+		const uint8_t *buf_rx;
+		size_t reat;
 		LV2_OSC_Reader reader;
 
-		lv2_osc_writer_initialize(&writer, buf1, BUF_SIZE);
-		assert(lv2_osc_writer_message_vararg(&writer, path, "") == true);
+		assert( (buf_rx = _stash_read_req(&stash[0][0], &reat)) );
+		lv2_osc_reader_initialize(&reader, buf_rx, reat);
+		assert(lv2_osc_reader_is_message(&reader));
 
-		size_t len;
-		const uint8_t *buf = lv2_osc_writer_finalize(&writer, &len);
-		assert(buf);
-		assert(len);
+		OSC_READER_MESSAGE_FOREACH(&reader, arg, reat)
+		{
+			if(i == 1)
+			{
+				assert(strcmp(arg->path, "/jumbo") == 0);
+				assert(arg->size == sizeof(blob));
+				assert(memcmp(arg->b, blob, sizeof(blob)) == 0);
+			}
+			else
+			{
+				assert(strcmp(arg->path, "/small") == 0);
+				assert(arg->i == (int32_t)(i / 2));
+			}
+		}
 
-		lv2_osc_reader_initialize(&reader, buf, len);
-		lv2_osc_reader_match(&reader, len, tree_root, NULL);
+		_stash_read_adv(&stash[0][0]);
 	}
 
-	return true;
+	assert(lv2_osc_stream_deinit(client) == 0);
+	assert(lv2_osc_stream_deinit(server) == 0);
+
+	for(unsigned s = 0; s < 2; s++)
+	{
+		_stash_free(&stash[s][0]);
+		_stash_free(&stash[s][1]);
+	}
+
+	free(client);
+	free(server);
+
+	return 0;
 }
 
 static int
-_run_test_hooks()
+_run_test_multicast(const char *url)
 {
-	{
-		assert(_run_test_hooks_internal("/nil") == true);
+	LV2_OSC_Stream *member = calloc(3, sizeof(LV2_OSC_Stream));
+	stash_t stash [3][2];
+
+	assert(member);
+	memset(stash, 0x0, sizeof(stash));
+
+	// all members join the same group and port
+	for(unsigned m = 0; m < 3; m++)
+	{
+		assert(lv2_osc_stream_init(&member[m], url, &driv, stash[m]) == 0);
+	}
+
+	// every member sees every packet, including its own via loopback
+	_peers_send(stash[0], "/group", 0);
+	assert(lv2_osc_stream_run(&member[0]) & LV2_OSC_SEND);
+
+	for(unsigned m = 0; m < 3; m++)
+	{
+		_peers_recv(&member[m], stash[m], 1);
+		_stash_read_adv(&stash[m][0]);
+	}
+
+	// replies still go to the group, not to the most recent sender
+	_peers_send(stash[1], "/group", 1);
+	assert(lv2_osc_stream_run(&member[1]) & LV2_OSC_SEND);
+
+	for(unsigned m = 0; m < 3; m++)
+	{
+		_peers_recv(&member[m], stash[m], 1);
+		assert(stash[m][0].size == 1);
+	}
+
+	for(unsigned m = 0; m < 3; m++)
+	{
+		assert(lv2_osc_stream_deinit(&member[m]) == 0);
+		_stash_free(&stash[m][0]);
+		_stash_free(&stash[m][1]);
+	}
+
+	free(member);
+
+	return 0;
+}
+
+#if LV2_OSC_STREAM_SHM
+static LV2_OSC_Stream *shm_server;
+static stash_t *shm_stash;
+
+static void *
+_shm_thread(void *data)
+{
+	const struct timespec ts = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+	nanosleep(&ts, NULL);
+
+	if(data) // wake up waiting client only
+	{
+		lv2_osc_stream_wake(data);
+	}
+	else // send to waiting client
+	{
+		_peers_send(shm_stash, "/wake", 0);
+		assert(lv2_osc_stream_run(shm_server) & LV2_OSC_SEND);
+	}
+
+	return NULL;
+}
+
+static atomic_bool shm_waking;
+
+// keep waking up a client while it is torn down and set up again
+static void *
+_shm_waker(void *data)
+{
+	while(atomic_load(&shm_waking))
+	{
+		lv2_osc_stream_wake(data);
+	}
+
+	return NULL;
+}
+
+static int
+_run_test_shm_wait(void)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [2][2];
+	pthread_t thread;
+
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
+	shm_server = server;
+	shm_stash = stash[0];
+
+	// region left behind by a crashed server is taken over
+	const pid_t pid = fork();
+	assert(pid >= 0);
+	if(pid == 0)
+	{
+		_exit(lv2_osc_stream_init(server, "osc.shm:///osc_test_wait", &driv,
+			stash[0]) != 0);
+	}
+	int status;
+	assert( (waitpid(pid, &status, 0) == pid) && (status == 0) );
+
+	assert(lv2_osc_stream_init(server, "osc.shm:///osc_test_wait", &driv,
+		stash[0]) == 0);
+
+	// region of a live server is left alone
+	assert( (lv2_osc_stream_init(client, "osc.shm:///osc_test_wait", &driv,
+		stash[1]) & LV2_OSC_ERR) == EADDRINUSE);
+	assert(lv2_osc_stream_deinit(client) == 0);
+
+	assert(lv2_osc_stream_init(client, "osc.shm://localhost/osc_test_wait", &driv,
+		stash[1]) == 0);
+	assert(lv2_osc_stream_run(server) & LV2_OSC_CONN);
+
+	// blocked client is woken up by server sending
+	time_t t0 = time(NULL);
+	assert(pthread_create(&thread, NULL, _shm_thread, NULL) == 0);
+	assert(lv2_osc_stream_pollin(client, 5000) & LV2_OSC_RECV);
+	assert(difftime(time(NULL), t0) < 2.0);
+	assert(pthread_join(thread, NULL) == 0);
+	assert(stash[1][0].size == 1);
+
+	// blocked client is woken up explicitly
+	t0 = time(NULL);
+	assert(pthread_create(&thread, NULL, _shm_thread, client) == 0);
+	assert(!(lv2_osc_stream_pollin(client, 5000) & LV2_OSC_RECV));
+	assert(difftime(time(NULL), t0) < 2.0);
+	assert(pthread_join(thread, NULL) == 0);
+
+	// client is woken up from another thread while it detaches and reattaches
+	atomic_store(&shm_waking, true);
+	assert(pthread_create(&thread, NULL, _shm_waker, client) == 0);
+	for(unsigned i = 0; i < 1000; i++)
+	{
+		assert(_lv2_osc_stream_reinit(client) == 0);
+		assert(lv2_osc_stream_run(client) & LV2_OSC_CONN);
+	}
+	atomic_store(&shm_waking, false);
+	assert(pthread_join(thread, NULL) == 0);
+
+	// client lets go of region of departed server
+	assert(lv2_osc_stream_deinit(server) == 0);
+	assert(!(lv2_osc_stream_run(client) & LV2_OSC_CONN));
+	assert(lv2_osc_stream_deinit(client) == 0);
+
+	// a successor on the same name keeps its region when we close
+	assert(lv2_osc_stream_init(server, "osc.shm:///osc_test_wait", &driv,
+		stash[0]) == 0);
+	assert(shm_unlink("/osc_test_wait") == 0);
+	assert(lv2_osc_stream_init(client, "osc.shm:///osc_test_wait", &driv,
+		stash[1]) == 0);
+	assert(lv2_osc_stream_deinit(server) == 0);
+
+	const int fd = shm_open("/osc_test_wait", O_RDONLY, 0);
+	assert(fd >= 0);
+	close(fd);
+
+	assert(lv2_osc_stream_deinit(client) == 0);
+	assert(shm_open("/osc_test_wait", O_RDONLY, 0) < 0);
+
+	for(unsigned s = 0; s < 2; s++)
+	{
+		_stash_free(&stash[s][0]);
+		_stash_free(&stash[s][1]);
+	}
+
+	free(client);
+	free(server);
+
+	return 0;
+}
+#endif
+
+static int
+_run_test_reconnect(void)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [2][2];
+
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
+
+	// never blocks on resolution nor refused connections
+	assert(lv2_osc_stream_init(client, "osc.tcp://localhost:2244", &driv,
+		stash[1]) == 0);
+
+	time_t t0 = time(NULL);
+	while(difftime(time(NULL), t0) < 2.0)
+	{
+		assert(!(lv2_osc_stream_run(client) & LV2_OSC_CONN));
+	}
+
+	// reconnects back off exponentially and reuse resolved address
+	assert(client->conn.backoff > 2*LV2_OSC_STREAM_BACKOFF_MIN);
+	assert(client->resolve.expiry && !client->resolve.job);
+
+	assert(lv2_osc_stream_init(server, "osc.tcp://:2244", &driv, stash[0]) == 0);
+
+	t0 = time(NULL);
+	while( !(lv2_osc_stream_run(client) & LV2_OSC_CONN) )
+	{
+		lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0*LV2_OSC_STREAM_BACKOFF_MAX/1000);
+	}
+
+	assert(client->conn.backoff == 0);
+
+	assert(lv2_osc_stream_deinit(client) == 0);
+	assert(lv2_osc_stream_deinit(server) == 0);
+	for(unsigned s = 0; s < 2; s++)
+	{
+		_stash_free(&stash[s][0]);
+		_stash_free(&stash[s][1]);
+	}
+
+	free(client);
+	free(server);
+
+	return 0;
+}
+
+static int
+_run_test_unix_stale(const char *server_url, const char *client_url,
+	const char *path, int type)
+{
+	LV2_OSC_Stream *server = calloc(2, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [3][2];
+	struct sockaddr_un sun;
+	struct stat st;
+
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
+	memset(&sun, 0x0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strcpy(sun.sun_path, path);
+	unlink(path);
+
+	// a path that is no socket is left alone
+	const int fd = open(path, O_CREAT | O_WRONLY, 0644);
+	assert(fd >= 0);
+	close(fd);
+
+	assert( (lv2_osc_stream_init(&server[0], server_url, &driv, stash[0])
+		& LV2_OSC_ERR) == EADDRINUSE);
+	assert( (stat(path, &st) == 0) && S_ISREG(st.st_mode) );
+	assert(unlink(path) == 0);
+	assert(lv2_osc_stream_deinit(&server[0]) == 0);
+
+	// a socket left behind by a previous server is replaced
+	const int sock = socket(AF_UNIX, type, 0);
+	assert(sock >= 0);
+	assert(bind(sock, (struct sockaddr *)&sun, sizeof(sun)) == 0);
+	close(sock);
+
+	assert(lv2_osc_stream_init(&server[0], server_url, &driv, stash[0]) == 0);
+
+	// a live server keeps its socket
+	assert( (lv2_osc_stream_init(&server[1], server_url, &driv, stash[1])
+		& LV2_OSC_ERR) == EADDRINUSE);
+
+	assert(lv2_osc_stream_init(client, client_url, &driv, stash[2]) == 0);
+	_peers_send(stash[2], "/hello", 0);
+	_peers_flush(client);
+	_peers_recv(&server[0], stash[0], 1);
+	assert(lv2_osc_stream_deinit(client) == 0);
+	assert(lv2_osc_stream_deinit(&server[1]) == 0);
+
+	// a successor on the same path keeps its socket when we close
+	assert(unlink(path) == 0);
+	assert(lv2_osc_stream_init(&server[1], server_url, &driv, stash[1]) == 0);
+	assert(lv2_osc_stream_deinit(&server[0]) == 0);
+	assert( (stat(path, &st) == 0) && S_ISSOCK(st.st_mode) );
+
+	assert(lv2_osc_stream_deinit(&server[1]) == 0);
+	assert(stat(path, &st) != 0);
+	for(unsigned s = 0; s < 3; s++)
+	{
+		_stash_free(&stash[s][0]);
+		_stash_free(&stash[s][1]);
+	}
+
+	free(client);
+	free(server);
+
+	return 0;
+}
+
+// append uint32_t prefix frame of given payload size to buf
+static size_t
+_prefix_frame(uint8_t *buf, uint32_t size, uint8_t fill)
+{
+	const uint32_t prefix = htonl(size);
+
+	memcpy(buf, &prefix, sizeof(uint32_t));
+	memset(buf + sizeof(uint32_t), fill, size);
+
+	return sizeof(uint32_t) + size;
+}
+
+static void
+_prefix_recv(LV2_OSC_Stream *server, stash_t *stash, unsigned count,
+	LV2_OSC_Enum *ev)
+{
+	const time_t t0 = time(NULL);
+
+	while(stash->size < count)
+	{
+		*ev |= lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+}
+
+// send all of buf without blocking, while the server keeps receiving
+static void
+_prefix_send(LV2_OSC_Stream *server, int sock, const uint8_t *buf, size_t len,
+	LV2_OSC_Enum *ev)
+{
+	const time_t t0 = time(NULL);
+
+	for(size_t off = 0; off < len; )
+	{
+		const ssize_t sent = send(sock, buf + off, len - off, MSG_DONTWAIT);
+
+		if(sent > 0)
+		{
+			off += sent;
+		}
+		else
+		{
+			assert( (errno == EAGAIN) || (errno == EWOULDBLOCK) );
+		}
+
+		*ev |= lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+}
+
+static int
+_run_test_prefix_frames(void)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	uint8_t *buf = malloc(LV2_OSC_STREAM_FRAME_MAX + 0x100);
+	stash_t stash [2];
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	size_t len = 0;
+
+	assert(server && buf);
+	memset(stash, 0x0, sizeof(stash));
+
+	assert(lv2_osc_stream_init(server, "osc.prefix.tcp://:2288", &driv, stash) == 0);
+
+	const int sock = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(2288),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+	};
+	assert(sock >= 0);
+	assert(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	// many frames per read, last one split across reads
+	for(unsigned i = 0; i < 64; i++)
+	{
+		len += _prefix_frame(buf + len, 8 + i, i);
+	}
+	len += _prefix_frame(buf + len, 0x2000, 0xff);
+	assert(send(sock, buf, len - 0x1000, 0) == (ssize_t)(len - 0x1000));
+	_prefix_recv(server, &stash[0], 64, &ev);
+	assert(stash[0].size == 64);
+
+	for(size_t i = len - 0x1000; i < len; i += 0x400)
+	{
+		assert(send(sock, buf + i, 0x400, 0) == 0x400);
+		ev |= lv2_osc_stream_run(server);
+	}
+	_prefix_recv(server, &stash[0], 65, &ev);
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+
+	for(unsigned i = 0; i < 65; i++)
+	{
+		size_t size;
+		const uint8_t *item = _stash_read_req(&stash[0], &size);
+
+		assert(size == ( (i < 64) ? 8 + i : 0x2000) );
+		assert(item[0] == ( (i < 64) ? i : 0xff) );
+		assert(item[size - 1] == item[0]);
+		_stash_read_adv(&stash[0]);
+	}
+
+	// frames exceeding the receive buffer are assembled on the heap
+	len = _prefix_frame(buf, 0x25000, 0xaa);
+	len += _prefix_frame(buf + len, 16, 0x55);
+	ev = LV2_OSC_NONE;
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], 2, &ev);
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+
+	size_t size;
+	const uint8_t *item = _stash_read_req(&stash[0], &size);
+	assert( (size == 0x25000) && (item[0] == 0xaa) && (item[size - 1] == 0xaa) );
+	_stash_read_adv(&stash[0]);
+	item = _stash_read_req(&stash[0], &size);
+	assert( (size == 16) && (item[0] == 0x55) );
+	_stash_read_adv(&stash[0]);
+
+	// frames exceeding LV2_OSC_STREAM_FRAME_MAX are skipped
+	len = _prefix_frame(buf, LV2_OSC_STREAM_FRAME_MAX, 0xaa);
+	len += _prefix_frame(buf + len, 16, 0x55);
+	ev = LV2_OSC_NONE;
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], 1, &ev);
+	assert( (ev & LV2_OSC_ERR) == EMSGSIZE);
+
+	item = _stash_read_req(&stash[0], &size);
+	assert( (size == 16) && (item[0] == 0x55) );
+	_stash_read_adv(&stash[0]);
+
+	// a full ring is retried once drained, not reported as error
+	len = 0;
+	for(unsigned i = 0; i < 8; i++)
+	{
+		len += _prefix_frame(buf + len, 16, i);
+	}
+	stash[0].cap = 4;
+	ev = LV2_OSC_NONE;
+	_prefix_send(server, sock, buf, len, &ev);
+	for(unsigned i = 0; i < 16; i++)
+	{
+		ev |= lv2_osc_stream_run(server);
+	}
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+	assert(stash[0].size == 4);
+
+	stash[0].cap = 0;
+	_prefix_recv(server, &stash[0], 8, &ev);
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+
+	for(unsigned i = 0; i < 8; i++)
+	{
+		item = _stash_read_req(&stash[0], &size);
+		assert( (size == 16) && (item[0] == i) );
+		_stash_read_adv(&stash[0]);
+	}
+
+	close(sock);
+	assert(lv2_osc_stream_deinit(server) == 0);
+	_stash_free(&stash[0]);
+	_stash_free(&stash[1]);
+
+	free(buf);
+	free(server);
+
+	return 0;
+}
+
+#define SERIAL_VMIN 64
+
+static int
+_run_test_serial(void)
+{
+	LV2_OSC_Stream *stream = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [2];
+	char url [PATH_MAX];
+	uint8_t blob [0x100];
+	uint8_t pkt [0x200];
+	uint8_t enc [0x400];
+	LV2_OSC_Writer writer;
+	size_t len;
+#if LV2_OSC_STREAM_TERMIOS2
+	const unsigned baud = 1234567; // non-standard
+#else
+	const unsigned baud = 230400;
+#endif
+
+	assert(stream);
+	memset(stash, 0x0, sizeof(stash));
+
+	const int master = posix_openpt(O_RDWR | O_NOCTTY);
+	assert(master >= 0);
+	assert(grantpt(master) == 0);
+	assert(unlockpt(master) == 0);
+
+	snprintf(url, sizeof(url), "osc.serial://%s?parity=mark", ptsname(master));
+	assert(lv2_osc_stream_init(stream, url, &driv, stash) != 0);
+	assert(lv2_osc_stream_deinit(stream) == 0);
+
+	snprintf(url, sizeof(url),
+		"osc.serial://%s?baud=%u&parity=even&flow=rtscts&vmin=%u",
+		ptsname(master), baud, SERIAL_VMIN);
+	assert(lv2_osc_stream_init(stream, url, &driv, stash) == 0);
+
+	// line settings, but ptys always clear parity
+	struct termios tty;
+	assert(tcgetattr(stream->sock, &tty) == 0);
+	assert(tty.c_cflag & CRTSCTS);
+	assert( (tty.c_iflag & (ICRNL | IXON)) == 0);
+	assert(tty.c_cc[VMIN] == SERIAL_VMIN);
+#if LV2_OSC_STREAM_TERMIOS2
+	LV2_OSC_Termios2 tty2;
+	assert(ioctl(stream->sock, LV2_OSC_STREAM_TCGETS2, &tty2) == 0);
+	assert( (tty2.c_cflag & CBAUD) == LV2_OSC_STREAM_BOTHER);
+	assert(tty2.c_ospeed == baud);
+#else
+	assert(cfgetospeed(&tty) == B230400);
+#endif
+
+	// packet with every byte value, e.g. CR, XON, XOFF, END and ESC
+	for(unsigned i = 0; i < sizeof(blob); i++)
+	{
+		blob[i] = i;
+	}
+	lv2_osc_writer_initialize(&writer, pkt, sizeof(pkt));
+	assert(lv2_osc_writer_message_vararg(&writer, "/serial", "b",
+		(int32_t)sizeof(blob), blob));
+	assert(lv2_osc_writer_finalize(&writer, &len) == pkt);
+
+	const size_t size = lv2_osc_slip_encode(enc, sizeof(enc), pkt, len);
+	assert(size > SERIAL_VMIN);
+
+	// device only becomes readable once vmin bytes are pending
+	struct pollfd fds = {
+		.fd = stream->sock,
+		.events = POLLIN,
+		.revents = 0
+	};
+
+	assert(write(master, enc, SERIAL_VMIN / 2) == SERIAL_VMIN / 2);
+	assert(poll(&fds, 1, 50) == 0);
+	assert(write(master, enc + SERIAL_VMIN / 2, size - SERIAL_VMIN / 2)
+		== (ssize_t)(size - SERIAL_VMIN / 2));
+	assert(poll(&fds, 1, 1000) == 1);
+
+	const time_t t0 = time(NULL);
+	while(stash[0].size < 1)
+	{
+		assert( (lv2_osc_stream_run(stream) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+
+	assert(stash[0].items[0]->size == len);
+	assert(memcmp(stash[0].items[0]->buf, pkt, len) == 0);
+
+	// sent packets arrive unaltered
+	uint8_t *dst;
+	assert( (dst = _stash_write_req(&stash[1], len, NULL)) );
+	memcpy(dst, pkt, len);
+	_stash_write_adv(&stash[1], len);
+	assert(lv2_osc_stream_run(stream) & LV2_OSC_SEND);
+
+	size_t recvd = 0;
+	size_t dec = 0;
+	while(!dec)
+	{
+		fds.fd = master;
+		assert(poll(&fds, 1, 1000) == 1);
+
+		const ssize_t n = read(master, enc + recvd, sizeof(enc) - recvd);
+		assert(n > 0);
+		recvd += n;
+
+		if(lv2_osc_slip_decode_inline(enc, recvd, &dec))
+		{
+			assert(dec == len);
+		}
+	}
+	assert(memcmp(enc, pkt, len) == 0);
+
+	assert(lv2_osc_stream_deinit(stream) == 0);
+	close(master);
+	_stash_free(&stash[0]);
+	_stash_free(&stash[1]);
+	free(stream);
+
+	return 0;
+}
+
+#define BATCH_COUNT 2000
+#define BATCH_BIG 0x11000 // exceeds stream buffers
+
+// packet of varying size, unique per index, some exceed stream buffers
+static size_t
+_batch_packet(uint8_t *buf, size_t max, int32_t i)
+{
+	LV2_OSC_Writer writer;
+	static uint8_t blob [BATCH_BIG + BATCH_COUNT];
+	const int32_t len = (i % 500 == 499) ? BATCH_BIG + i : i % 512;
+	size_t writ;
+
+	for(int32_t j = 0; j < len; j++)
+	{
+		blob[j] = i + j; // SLIP special bytes included
+	}
+	memset(buf, 0x0, max); // blob padding is left as is
+	lv2_osc_writer_initialize(&writer, buf, max);
+	assert(lv2_osc_writer_message_vararg(&writer, "/batch", "ib",
+		i, len, blob));
+	assert(lv2_osc_writer_finalize(&writer, &writ) == buf);
+
+	return writ;
+}
+
+static int
+_run_test_batch(const char *server_url, const char *client_url)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(1, sizeof(LV2_OSC_Stream));
+	stash_t stash [2][2];
+	static uint8_t buf [BATCH_BIG + BATCH_COUNT + 0x100];
+
+	memset(stash, 0x0, sizeof(stash));
+
+	assert(lv2_osc_stream_init(server, server_url, &driv, stash[0]) == 0);
+	assert(lv2_osc_stream_init(client, client_url, &driv, stash[1]) == 0);
+
+	const time_t t0 = time(NULL);
+	while( !(lv2_osc_stream_run(client) & LV2_OSC_CONN) )
+	{
+		lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+
+	// small send buffer forces partial writes of staged frames
+	const int sndbuf = 4096;
+	assert(setsockopt(client->sock, SOL_SOCKET, SO_SNDBUF, &sndbuf,
+		sizeof(sndbuf)) == 0);
+
+	for(int32_t i = 0; i < BATCH_COUNT; i++)
+	{
+		const size_t size = _batch_packet(buf, sizeof(buf), i);
+		uint8_t *dst;
+
+		assert( (dst = _stash_write_req(&stash[1][1], size, NULL)) );
+		memcpy(dst, buf, size);
+		_stash_write_adv(&stash[1][1], size);
+	}
+
+	// fill socket buffers without the server reading
+	for(unsigned i = 0; i < 8; i++)
+	{
+		assert( (lv2_osc_stream_run(client) & LV2_OSC_ERR) == LV2_OSC_NONE);
+	}
+	assert(stash[1][1].size > 0);
+
+	const time_t t1 = time(NULL);
+	while(stash[0][0].size < BATCH_COUNT)
+	{
+		assert( (lv2_osc_stream_run(client) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert( (lv2_osc_stream_run(server) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert(difftime(time(NULL), t1) < 2.0);
+	}
+
+	// all in order and intact
+	for(int32_t i = 0; i < BATCH_COUNT; i++)
+	{
+		const size_t size = _batch_packet(buf, sizeof(buf), i);
+		const item_t *item = stash[0][0].items[i];
+
+		assert(item->size == size);
+		assert(memcmp(item->buf, buf, size) == 0);
+	}
+
+	// staged frames stay queued until written, and go out again from the first
+	// partially written one after reconnecting
+	for(int32_t i = 0; i < BATCH_COUNT; i++)
+	{
+		const size_t size = _batch_packet(buf, sizeof(buf), i);
+		uint8_t *dst;
+
+		assert( (dst = _stash_write_req(&stash[1][1], size, NULL)) );
+		memcpy(dst, buf, size);
+		_stash_write_adv(&stash[1][1], size);
+	}
+
+	for(unsigned i = 0; i < 8; i++)
+	{
+		assert( (lv2_osc_stream_run(client) & LV2_OSC_ERR) == LV2_OSC_NONE);
+	}
+	assert(client->tx_off < client->tx_len + client->tx_ext);
+	assert(stash[1][1].size >= lv2_osc_stream_staged(client));
+	assert(stash[1][1].size > 0);
+
+	unsigned slot = 0;
+	while(server->clients[slot].fd < 0)
+	{
+		slot++;
+	}
+
+	assert(_lv2_osc_stream_reinit(client) == 0);
+
+	// drain old connection first, its trailing partial frame is dropped
+	const time_t t2 = time(NULL);
+	while(server->clients[slot].fd >= 0)
+	{
+		assert( (lv2_osc_stream_run(server) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert(difftime(time(NULL), t2) < 2.0);
+	}
+
+	while(stash[0][0].size < 2*BATCH_COUNT)
+	{
+		assert( (lv2_osc_stream_run(client) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert( (lv2_osc_stream_run(server) & LV2_OSC_ERR) == LV2_OSC_NONE);
+		assert(difftime(time(NULL), t2) < 2.0);
+	}
+
+	for(int32_t i = 0; i < BATCH_COUNT; i++)
+	{
+		const size_t size = _batch_packet(buf, sizeof(buf), i);
+		const item_t *item = stash[0][0].items[BATCH_COUNT + i];
+
+		assert(item->size == size);
+		assert(memcmp(item->buf, buf, size) == 0);
+	}
+	assert(stash[1][1].size == 0);
+
+	assert(lv2_osc_stream_deinit(client) == 0);
+	assert(lv2_osc_stream_deinit(server) == 0);
+
+	for(unsigned s = 0; s < 2; s++)
+	{
+		_stash_free(&stash[s][0]);
+		_stash_free(&stash[s][1]);
+	}
+
+	free(client);
+	free(server);
+
+	return 0;
+}
+
+// random payload with a given share of SLIP special bytes in percent
+static void
+_slip_fill(uint8_t *buf, size_t len, unsigned share)
+{
+	for(size_t i = 0; i < len; i++)
+	{
+		const unsigned r = rand() % 100;
+
+		if(r < share)
+		{
+			buf[i] = (r & 1) ? SLIP_END : SLIP_ESC;
+		}
+		else
+		{
+			buf[i] = rand() & 0xff;
+		}
+	}
+}
+
+static int
+_run_test_slip(void)
+{
+	static uint8_t src [0x400];
+	static uint8_t ref [0x1000];
+	static uint8_t enc [0x2000];
+	const unsigned shares [] = { 0, 1, 10, 50, 100 };
+
+	srand(0);
+
+	for(size_t len = 1; len <= sizeof(src); len += (len < 80) ? 1 : 37)
+	{
+		for(unsigned s = 0; s < sizeof(shares)/sizeof(unsigned); s++)
+		{
+			_slip_fill(src, len, shares[s]);
+
+			// single pass encoder matches in place one
+			memcpy(ref, src, len);
+			const size_t size = lv2_osc_slip_encode_inline(ref, len);
+			assert(size >= len + 2);
+			assert(lv2_osc_slip_encode(enc, sizeof(enc), src, len) == size);
+			assert(memcmp(enc, ref, size) == 0);
+
+			// refuse to exceed destination
+			assert(lv2_osc_slip_encode(enc, size - 1, src, len) == 0);
+			assert(lv2_osc_slip_encode(enc, size, src, len) == size);
+
+			// incomplete frames are left alone
+			size_t dec = 1;
+			assert(lv2_osc_slip_decode_inline(enc, size - 1, &dec) == 0);
+			assert(dec == 0);
+			assert(memcmp(enc, ref, size) == 0);
+
+			// back-to-back frames decode one by one
+			memcpy(enc + size, ref, size);
+			assert(lv2_osc_slip_decode_inline(enc, 2*size, &dec) == size);
+			assert(dec == len);
+			assert(memcmp(enc, src, len) == 0);
+			assert(lv2_osc_slip_decode_inline(enc + size, size, &dec) == size);
+			assert(dec == len);
+			assert(memcmp(enc + size, src, len) == 0);
+
+			// encoding in parts matches encoding in one go
+			size_t off = 0;
+			size_t part = 1;
+
+			enc[0] = SLIP_END;
+			for(size_t pos = 1; off < len; part = part*3 + 1)
+			{
+				size_t consumed;
+
+				pos += lv2_osc_slip_encode_part(enc + pos, part, src + off, len - off,
+					&consumed);
+				off += consumed;
+				assert(pos < sizeof(enc) - 1);
+				enc[pos] = SLIP_END;
+			}
+			assert(memcmp(enc, ref, size) == 0);
+
+			// frames without leading END are parsed but dropped
+			assert(lv2_osc_slip_decode_inline(ref + 1, size - 1, &dec) == size - 1);
+			assert(dec == 0);
+		}
+	}
+
+	return 0;
+}
+
+static int
+_run_test_slip_frames(void)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	uint8_t *buf = malloc(LV2_OSC_STREAM_FRAME_MAX + 0x100);
+	stash_t stash [2];
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	size_t len = 0;
+
+	assert(server && buf);
+	memset(stash, 0x0, sizeof(stash));
+
+	assert(lv2_osc_stream_init(server, "osc.slip.tcp://:2299", &driv, stash) == 0);
+
+	const int sock = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(2299),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+	};
+	assert(sock >= 0);
+	assert(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	// frames exceeding the receive buffer are assembled on the heap
+	buf[len++] = SLIP_END;
+	memset(buf + len, 0xaa, 0x25000);
+	len += 0x25000;
+	buf[len++] = SLIP_END;
+	buf[len++] = SLIP_END;
+	memset(buf + len, 0x55, 16);
+	len += 16;
+	buf[len++] = SLIP_END;
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], 2, &ev);
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+
+	size_t size;
+	const uint8_t *item = _stash_read_req(&stash[0], &size);
+	assert( (size == 0x25000) && (item[0] == 0xaa) && (item[size - 1] == 0xaa) );
+	_stash_read_adv(&stash[0]);
+	item = _stash_read_req(&stash[0], &size);
+	assert( (size == 16) && (item[0] == 0x55) );
+	_stash_read_adv(&stash[0]);
+
+	// frames exceeding LV2_OSC_STREAM_FRAME_MAX are skipped until their END
+	len = 0;
+	buf[len++] = SLIP_END;
+	memset(buf + len, 0xaa, LV2_OSC_STREAM_FRAME_MAX);
+	len += LV2_OSC_STREAM_FRAME_MAX;
+	buf[len++] = SLIP_END;
+	buf[len++] = SLIP_END;
+	memset(buf + len, 0x55, 16);
+	len += 16;
+	buf[len++] = SLIP_END;
+	ev = LV2_OSC_NONE;
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], 1, &ev);
+	assert( (ev & LV2_OSC_ERR) == EMSGSIZE);
+
+	item = _stash_read_req(&stash[0], &size);
+	assert( (size == 16) && (item[0] == 0x55) );
+
+	close(sock);
+	assert(lv2_osc_stream_deinit(server) == 0);
+	_stash_free(&stash[0]);
+	_stash_free(&stash[1]);
+
+	free(buf);
+	free(server);
+
+	return 0;
+}
+
+#define FRAME_MAX_RING 0x1000
+
+// prefix or SLIP frame of size bytes of fill
+static size_t
+_frame_max_frame(uint8_t *buf, size_t max, bool slip, uint32_t size,
+	uint8_t fill)
+{
+	if(!slip)
+	{
+		return _prefix_frame(buf, size, fill);
+	}
+
+	uint8_t *payload = malloc(size);
+
+	assert(payload);
+	memset(payload, fill, size);
+	const size_t len = lv2_osc_slip_encode(buf, max, payload, size);
+	assert(len);
+	free(payload);
+
+	return len;
+}
+
+static int
+_run_test_frame_max(const char *url, uint16_t port)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	const size_t max = 0x30000;
+	uint8_t *buf = malloc(max);
+	stash_t stash [2];
+	LV2_OSC_Enum ev = LV2_OSC_NONE;
+	size_t len, size;
+	const uint8_t *item;
+
+	assert(server && buf);
+	memset(stash, 0x0, sizeof(stash));
+	stash[0].max = FRAME_MAX_RING;
+
+	assert(lv2_osc_stream_init(server, url, &driv_max, stash) == 0);
+
+	const int sock = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+	};
+	assert(sock >= 0);
+	assert(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	// frames the ring can never take are skipped without assembling them
+	len = _frame_max_frame(buf, max, server->slip, 0x10000, 0xaa);
+	len += _frame_max_frame(buf + len, max - len, server->slip, 16, 0x55);
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], 1, &ev);
+	assert( (ev & LV2_OSC_ERR) == EMSGSIZE);
+
+	item = _stash_read_req(&stash[0], &size);
+	assert( (size == 16) && (item[0] == 0x55) );
+	_stash_read_adv(&stash[0]);
+
+	for(unsigned i = 0; i < LV2_OSC_STREAM_CLIENTS; i++)
+	{
+		assert(server->clients[i].rx.big == NULL);
+	}
+
+	// frames of the largest size the ring takes still arrive
+	len = _frame_max_frame(buf, max, server->slip, FRAME_MAX_RING, 0x55);
+	if(server->slip) // escaped beyond ring size, but not decoded
+	{
+		len += _frame_max_frame(buf + len, max - len, true, FRAME_MAX_RING,
+			SLIP_END);
+	}
+	ev = LV2_OSC_NONE;
+	_prefix_send(server, sock, buf, len, &ev);
+	_prefix_recv(server, &stash[0], server->slip ? 2 : 1, &ev);
+	assert( (ev & LV2_OSC_ERR) == LV2_OSC_NONE);
+
+	while( (item = _stash_read_req(&stash[0], &size)) )
+	{
+		assert(size == FRAME_MAX_RING);
+		_stash_read_adv(&stash[0]);
+	}
+
+	close(sock);
+	assert(lv2_osc_stream_deinit(server) == 0);
+	_stash_free(&stash[0]);
+	_stash_free(&stash[1]);
+
+	free(buf);
+	free(server);
+
+	return 0;
+}
+
+static int
+_run_test_clients(const char *server_url, const char *client_url)
+{
+	LV2_OSC_Stream *server = calloc(1, sizeof(LV2_OSC_Stream));
+	LV2_OSC_Stream *client = calloc(2, sizeof(LV2_OSC_Stream));
+	stash_t stash [3][2];
+
+	assert(server && client);
+	memset(stash, 0x0, sizeof(stash));
+
+	assert(lv2_osc_stream_init(server, server_url, &driv, stash[0]) == 0);
+	assert(lv2_osc_stream_get_peers(server) == 0);
+
+	// connect both clients
+	for(unsigned c = 0; c < 2; c++)
+	{
+		assert(lv2_osc_stream_init(&client[c], client_url, &driv,
+			stash[1+c]) == 0);
+
+		const time_t t0 = time(NULL);
+		while( !(lv2_osc_stream_run(&client[c]) & LV2_OSC_CONN) )
+		{
+			lv2_osc_stream_run(server);
+			assert(difftime(time(NULL), t0) < 2.0);
+		}
+
+		_peers_send(stash[1+c], "/hello", c);
+		assert(lv2_osc_stream_run(&client[c]) & LV2_OSC_SEND);
+	}
+
+	_peers_recv(server, stash[0], 2);
+	assert(lv2_osc_stream_get_peers(server) == 2);
+
+	int fds [LV2_OSC_STREAM_FDS];
+	assert(lv2_osc_stream_get_all_file_descriptors(server, fds) == 3);
+
+	// broadcast to all clients
+	_peers_send(stash[0], "/all", 0);
+	_peers_send(stash[0], "/all", 1);
+	assert(lv2_osc_stream_run(server) & LV2_OSC_SEND);
+	assert(stash[0][1].size == 0);
+
+	for(unsigned c = 0; c < 2; c++)
+	{
+		_peers_recv(&client[c], stash[1+c], 2);
+		assert(stash[1+c][0].size == 2);
+	}
+
+	// server drops disconnected client
+	assert(lv2_osc_stream_deinit(&client[0]) == 0);
+
+	time_t t0 = time(NULL);
+	while(lv2_osc_stream_get_peers(server) != 1)
+	{
+		lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+
+	// server drops client not reading while the other one waits for more
+	static uint8_t blob [0x8000];
+
+	assert(lv2_osc_stream_init(&client[0], client_url, &driv, stash[1]) == 0);
+
+	t0 = time(NULL);
+	while(lv2_osc_stream_get_peers(server) != 2)
+	{
+		lv2_osc_stream_run(&client[0]);
+		lv2_osc_stream_run(server);
+		assert(difftime(time(NULL), t0) < 2.0);
+	}
+
+	t0 = time(NULL);
+	while(lv2_osc_stream_get_peers(server) != 1)
+	{
+		if(stash[0][1].size == 0)
+		{
+			_peers_send_blob(stash[0], "/blob", blob, sizeof(blob));
+		}
+
+		lv2_osc_stream_run(server);
+		lv2_osc_stream_run(&client[1]);
+
+		while(stash[2][0].size)
+		{
+			_stash_read_adv(&stash[2][0]);
+		}
+
+		assert(difftime(time(NULL), t0) < 5.0);
+	}
+
+	assert(lv2_osc_stream_deinit(&client[0]) == 0);
+	assert(lv2_osc_stream_deinit(&client[1]) == 0);
+	for(unsigned c = 0; c < 2; c++)
+	{
+		_stash_free(&stash[1+c][0]);
+		_stash_free(&stash[1+c][1]);
+	}
+
+	assert(lv2_osc_stream_deinit(server) == 0);
+	_stash_free(&stash[0][0]);
+	_stash_free(&stash[0][1]);
+
+	free(client);
+	free(server);
+
+	return 0;
+}
+#endif
+
+#if !defined(_WIN32)
+static unsigned foo_sub_one = 0;
+static unsigned foo_sub_two [2] = { 0, 0 };
+static unsigned foo = 0;
+static unsigned bar = 0;
+
+static void
+_one(const char *path, unsigned *flag)
+{
+	*flag += 1;
+
+	if(!path)
+	{
+		return;
+	}
+
+	assert(!strcmp(path, "/sub/one")
+		|| !strcmp(path, "/*/one")
+		|| !strcmp(path, "/s*/one")
+		|| !strcmp(path, "/su*/one")
+		|| !strcmp(path, "/sub*/one")
+		|| !strcmp(path, "/sub/*")
+		|| !strcmp(path, "/*sub/one")
+		|| !strcmp(path, "/*s*u*b*/one")
+		|| !strcmp(path, "/su[ab]/one")
+		|| !strcmp(path, "/su[a-b]/[!a-np-z]ne")
+		|| !strcmp(path, "/su[a-b]/one")
+		|| !strcmp(path, "/s?b/?ne")
+		|| !strcmp(path, "/s?*/?ne")
+		|| !strcmp(path, "/s?*/*?e")
+		|| !strcmp(path, "/sub/{one,two}"));
+}
+
+static void
+_two(const char *path, unsigned *flag)
+{
+	*flag += 1;
+
+	if(!path)
+	{
+		return;
+	}
+
+	assert(!strcmp(path, "/sub/two")
+		|| !strcmp(path, "/sub/*")
+		|| !strcmp(path, "/sub/{one,two}"));
+}
+
+static void
+_foo(const char *path, unsigned *flag)
+{
+	*flag += 1;
+
+	if(!path)
+	{
+		return;
+	}
+
+	assert(!strcmp(path, "/foo")
+		|| !strcmp(path, "/{foo,bar}"));
+}
+
+static void
+_bar(const char *path, unsigned *flag)
+{
+	*flag += 1;
+
+	if(!path)
+	{
+		return;
+	}
+
+	assert(!strcmp(path, "/bar")
+		|| !strcmp(path, "/{foo,bar}"));
+}
+
+static void
+_hook_one(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
+	void *data)
+{
+	_one(path, data);
+}
+
+static void
+_hook_two(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
+	void *data)
+{
+	_two(path, data);
+}
+
+static void
+_hook_foo(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
+	void *data)
+{
+	_foo(path, data);
+}
+
+static void
+_hook_bar(const char *path, const LV2_Atom_Tuple *arguments __attribute__((unused)),
+	void *data)
+{
+	_bar(path, data);
+}
+
+static LV2_OSC_Hook hook_sub [] = {
+	{ .name = "one", .method = _hook_one, .data = &foo_sub_one },
+	{ .name = "two", .method = _hook_two, .data = &foo_sub_two[0] },
+	{ .name = "two", .method = _hook_two, .data = &foo_sub_two[1] },
+	{ .name = NULL }
+};
+
+static LV2_OSC_Hook hook_root [] = {
+	{ .name = "foo", .method = _hook_foo, .data = &foo },
+	{ .name = "bar", .method = _hook_bar, .data = &bar },
+	{ .name = "sub", .hooks = hook_sub },
+	{ .name = NULL }
+};
+
+static LV2_OSC_Tree tree_sub [4];
+
+static void
+_branch_one(LV2_OSC_Reader *reader __attribute__((unused)),
+	LV2_OSC_Arg *arg __attribute__((unused)),
+	const LV2_OSC_Tree *tree __attribute__((unused)),
+	void *data __attribute__((unused)))
+{
+	_one(NULL, &foo_sub_one);
+}
+
+static void
+_branch_two(LV2_OSC_Reader *reader __attribute__((unused)),
+	LV2_OSC_Arg *arg __attribute__((unused)),
+	const LV2_OSC_Tree *tree __attribute__((unused)),
+	void *data __attribute__((unused)))
+{
+	const size_t idx = tree - &tree_sub[1];
+
+	_two(NULL, &foo_sub_two[idx]);
+}
+
+static void
+_branch_foo(LV2_OSC_Reader *reader __attribute__((unused)),
+	LV2_OSC_Arg *arg __attribute__((unused)),
+	const LV2_OSC_Tree *tree __attribute__((unused)),
+	void *data __attribute__((unused)))
+{
+	_foo(NULL, &foo);
+}
+
+static void
+_branch_bar(LV2_OSC_Reader *reader __attribute__((unused)),
+	LV2_OSC_Arg *arg __attribute__((unused)),
+	const LV2_OSC_Tree *tree __attribute__((unused)),
+	void *data __attribute__((unused)))
+{
+	_bar(NULL, &bar);
+}
+
+static LV2_OSC_Tree tree_sub [] = {
+	{ .name = "one", .branch = _branch_one },
+	{ .name = "two", .branch = _branch_two },
+	{ .name = "two", .branch = _branch_two },
+	{ .name = NULL }
+};
+
+static LV2_OSC_Tree tree_root [] = {
+	{ .name = "foo", .branch = _branch_foo },
+	{ .name = "bar", .branch = _branch_bar },
+	{ .name = "sub", .trees = tree_sub },
+	{ .name = NULL }
+};
+
+static bool
+_run_test_hooks_internal(const char *path)
+{
+	foo_sub_one = foo_sub_two[0] = foo_sub_two[1] = foo = bar = false;
+
+	{
+		LV2_OSC_URID osc_urid;
+		LV2_Atom_Forge forge;
+
+		lv2_osc_urid_init(&osc_urid, &map);
+		lv2_atom_forge_init(&forge, &map);
+
+		lv2_atom_forge_set_buffer(&forge, buf0, BUF_SIZE);
+		assert(lv2_osc_forge_message_vararg(&forge, &osc_urid, path, ""));
+
+		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)buf0;;
+		assert(lv2_osc_unroll(&osc_urid, obj, lv2_osc_hooks, hook_root) == true);
+	}
+
+	{
+		LV2_OSC_Writer writer;
+		LV2_OSC_Reader reader;
+
+		lv2_osc_writer_initialize(&writer, buf1, BUF_SIZE);
+		assert(lv2_osc_writer_message_vararg(&writer, path, "") == true);
+
+		size_t len;
+		const uint8_t *buf = lv2_osc_writer_finalize(&writer, &len);
+		assert(buf);
+		assert(len);
+
+		lv2_osc_reader_initialize(&reader, buf, len);
+		lv2_osc_reader_match(&reader, len, tree_root, NULL);
+	}
+
+	return true;
+}
+
+static int
+_run_test_hooks()
+{
+	{
+		assert(_run_test_hooks_internal("/nil") == true);
 		assert(foo == 0);
 		assert(bar == 0);
 		assert(foo_sub_one == 0);
@@ -1360,6 +2781,61 @@ main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
 		assert(pthread_join(thread_1, NULL) == 0);
 		assert(pthread_join(thread_2, NULL) == 0);
 	}
+
+	fprintf(stdout, "running stream peer test\n");
+	assert(_run_test_peers() == 0);
+
+	fprintf(stdout, "running stream jumbo datagram tests\n");
+	assert(_run_test_jumbo("osc.udp://:2244", "osc.udp://localhost:2244") == 0);
+	assert(_run_test_jumbo("osc.udp://:2245?uring", "osc.udp://localhost:2245?uring") == 0);
+
+	fprintf(stdout, "running stream multicast tests\n");
+	assert(_run_test_multicast("osc.udp://239.255.0.1:2277?iface=lo&loop=1") == 0);
+
+#if LV2_OSC_STREAM_SHM
+	fprintf(stdout, "running stream shared memory test\n");
+	assert(_run_test_shm_wait() == 0);
+#endif
+
+	fprintf(stdout, "running stream reconnect test\n");
+	assert(_run_test_reconnect() == 0);
+
+	fprintf(stdout, "running stream stale socket tests\n");
+	assert(_run_test_unix_stale("osc.unix:///tmp/osc_test_stale.sock",
+		"osc.unix://localhost/tmp/osc_test_stale.sock",
+		"/tmp/osc_test_stale.sock", SOCK_DGRAM) == 0);
+	assert(_run_test_unix_stale("osc.unix.slip:///tmp/osc_test_stale.sock",
+		"osc.unix.slip://localhost/tmp/osc_test_stale.sock",
+		"/tmp/osc_test_stale.sock", SOCK_STREAM) == 0);
+
+	fprintf(stdout, "running stream prefix frame test\n");
+	assert(_run_test_prefix_frames() == 0);
+
+	fprintf(stdout, "running stream SLIP frame test\n");
+	assert(_run_test_slip_frames() == 0);
+
+	fprintf(stdout, "running stream frame maximum tests\n");
+	assert(_run_test_frame_max("osc.prefix.tcp://:2333", 2333) == 0);
+	assert(_run_test_frame_max("osc.slip.tcp://:2344", 2344) == 0);
+
+	fprintf(stdout, "running stream serial test\n");
+	assert(_run_test_serial() == 0);
+
+	fprintf(stdout, "running stream SLIP codec test\n");
+	assert(_run_test_slip() == 0);
+
+	fprintf(stdout, "running stream batch tests\n");
+	assert(_run_test_batch("osc.prefix.tcp://:2311",
+		"osc.prefix.tcp://localhost:2311") == 0);
+	assert(_run_test_batch("osc.slip.tcp://[]:2322",
+		"osc.slip.tcp://[::1]:2322") == 0);
+
+	fprintf(stdout, "running stream client tests\n");
+	assert(_run_test_clients("osc.tcp://:2255", "osc.tcp://localhost:2255") == 0);
+	assert(_run_test_clients("osc.prefix.tcp://[]:2266",
+		"osc.prefix.tcp://[::1]:2266") == 0);
+	assert(_run_test_clients("osc.unix.slip:///tmp/osc_test_clients.sock",
+		"osc.unix.slip://localhost/tmp/osc_test_clients.sock") == 0);
 #endif
 
 	for(unsigned i=0; i<__app.urid; i++)
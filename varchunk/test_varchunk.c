@@ -137,6 +137,27 @@ test_threaded()
 	varchunk_free(varchunk);
 }
 
+static void
+test_fill()
+{
+	varchunk_t *varchunk = varchunk_new(8192, true);
+	assert(varchunk);
+	assert(varchunk_fill(varchunk) == 0);
+
+	void *ptr = varchunk_write_request(varchunk, 13);
+	assert(ptr);
+	varchunk_write_advance(varchunk, 13);
+	assert(varchunk_fill(varchunk) == sizeof(varchunk_elmnt_t) + PAD(13));
+
+	size_t toread;
+	assert(varchunk_read_request(varchunk, &toread));
+	assert(toread == 13);
+	varchunk_read_advance(varchunk);
+	assert(varchunk_fill(varchunk) == 0);
+
+	varchunk_free(varchunk);
+}
+
 #if defined(VARCHUNK_USE_SHARED_MEM)
 typedef struct _varchunk_shm_t varchunk_shm_t;
 
@@ -244,6 +265,7 @@ main(int argc, char **argv)
 
 	assert(varchunk_is_lock_free());
 
+	test_fill();
 	test_threaded();
 
 #if defined(VARCHUNK_USE_SHARED_MEM)
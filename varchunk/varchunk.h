@@ -68,6 +68,9 @@ varchunk_read_request(varchunk_t *varchunk, size_t *toread);
 static inline void
 varchunk_read_advance(varchunk_t *varchunk);
 
+static inline size_t
+varchunk_fill(varchunk_t *varchunk);
+
 /*****************************************************************************
  * API END
  *****************************************************************************/
@@ -375,6 +378,18 @@ varchunk_read_advance(varchunk_t *varchunk)
 		sizeof(varchunk_elmnt_t) + VARCHUNK_PAD(elmnt->size));
 }
 
+static inline size_t
+varchunk_fill(varchunk_t *varchunk)
+{
+	assert(varchunk);
+
+	// bytes in use incl. element headers and gaps, a snapshot from either side
+	const size_t head = atomic_load_explicit(&varchunk->head, memory_order_relaxed);
+	const size_t tail = atomic_load_explicit(&varchunk->tail, memory_order_relaxed);
+
+	return (head - tail + varchunk->size) & varchunk->mask;
+}
+
 #undef VARCHUNK_PAD
 
 #ifdef __cplusplus